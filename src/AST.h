@@ -1,84 +1,167 @@
 #pragma once
 
+#include <atomic>
+#include <iterator>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include "frontend/TokenType.h"
 #include "frontend/Token.h"
+#include "frontend/VariableAttribute.h"
 
 using std::string;
 using std::vector;
 
+class AST;
+
+// contiguous children of an AST node, nullptr for a missing optional part
+class AstChildren
+{
+public:
+    AstChildren(AST *const *first, int count): first(first), count(count) {}
+
+    AST *const *begin() const {
+        return first;
+    }
+    AST *const *end() const {
+        return first + count;
+    }
+
+    int size() const {
+        return count;
+    }
+    bool empty() const {
+        return count == 0;
+    }
+
+    AST *operator[](int i) const {
+        return first[i];
+    }
+    AST *at(int i) const {
+        if (i < 0 || i >= count) {
+            throw std::out_of_range("AST child index out of range");
+        }
+        return first[i];
+    }
+    AST *back() const {
+        return at(count - 1);
+    }
+
+private:
+    AST *const *first;
+    int count;
+};
+
+/**
+ * @brief Fixed-size AST node, owned by an AstArena
+ *
+ * @details Leaves keep the interned text of their token, inner nodes an
+ * interned label of their type (e.g. "IfStmt").
+ */
 class AST
 {
 public:
-    AST(TokenType tokenType, const string &tokenStr, const vector<AST *> &children, int lineNo): 
-        tokenType(tokenType),
-        tokenStr(tokenStr), 
-        children(children),
-        lineNo(lineNo) {}
+    AST() = default;
 
-    AST(TokenType tokenType, const string &tokenStr, const vector<AST *> &children): 
+    // inner node, tokenType from DECL_LIST on
+    AST(TokenType tokenType, int lineNo):
         tokenType(tokenType),
-        tokenStr(tokenStr), 
-        children(children),
-        lineNo(0) {}
+        tokenId(labelIdOf(tokenType)),
+        lineNo(lineNo) {}
 
-    AST(TokenType tokenType, const string &tokenStr): 
-        tokenType(tokenType),
-        tokenStr(tokenStr), 
-        children(vector<AST *>()),
-        lineNo(0) {}
+    // tokenId: interned text of the token
+    AST(const Token &token, SymbolId tokenId):
+        tokenType(token.getTokenType()),
+        tokenId(tokenId),
+        lineNo(token.getLineNo()) {}
 
-    AST(const Token *tokenPtr):
-        tokenType(tokenPtr->getTokenType()),
-        tokenStr(tokenPtr->getTokenStr()),
-        children(vector<AST *>()),
-        lineNo(tokenPtr->getLineNo()) {}
+    AST(const Token &token, SymbolId tokenId, int lineNo):
+        tokenType(token.getTokenType()),
+        tokenId(tokenId),
+        lineNo(lineNo) {}
 
     TokenType getTokenType() const {
         return tokenType;
     }
 
-    string &getTokenStr() {
-        return tokenStr;
+    SymbolId getTokenId() const {
+        return tokenId;
     }
     const string &getTokenStr() const {
-        return tokenStr;
+        return Interner::global().nameOf(tokenId);
     }
 
-    const vector<AST *> &getChildren() const {
-        return children;
-    }
-    vector<AST *> &getChildren() {
-        return children;
+    AstChildren getChildren() const {
+        return AstChildren(children, childCount);
     }
 
     int getLineNo() const {
         return lineNo;
     }
 
+    // identifiers only, set by SemanticAnalyzer
+    const Binding &getBinding() const {
+        return binding;
+    }
+    void setBinding(const Binding &binding) {
+        this->binding = binding;
+    }
+
     /**
-     * @brief Postorder delete AST (root = node)
-     * Only node will be remained.
+     * @brief Number of nodes in the AST (root = node)
      */
-    static void destroyChildrenRecursively(AST *node) {
+    static long long countNodes(const AST *node) {
         if (node == nullptr) {
-            return;
+            return 0;
         }
 
-        for (auto child : node->children) {
-            destroyChildrenRecursively(child);
-            delete child;
+        long long count = 1;
+        for (auto child : node->getChildren()) {
+            count += countNodes(child);
         }
+        return count;
+    }
+
+private:
+    friend class AstArena;
+
+    void setChildren(AST *const *children, int childCount) {
+        this->children = children;
+        this->childCount = childCount;
     }
 
-    ~AST() {
-        // destroyChildrenRecursively(this); Double free
+    // labels of inner nodes, by TokenType from DECL_LIST
+    static constexpr int FIRST_LABELED_TYPE = static_cast<int>(TokenType::DECL_LIST);
+    static constexpr const char *LABELS[] = {
+        "DeclList", "VariableDecl", "FuncDecl", "ParamList", "Param", "CompoundStmt", "LocalVariableDecl",
+        "StmtList", "IfStmt", "WhileStmt", "ReturnStmt", "Variable", "Call", "ArgList",
+    };
+    static_assert(FIRST_LABELED_TYPE + std::size(LABELS) == static_cast<int>(TokenType::ARG_LIST) + 1,
+                  "a label for each inner node type");
+
+    /**
+     * @brief Interned label of an inner node type (e.g. "IfStmt"),
+     * interned at its first use only, so a node is made without
+     * allocating nor hashing. Shared by threads, as ASTs may be built in
+     * parallel: interning a label twice returns the same id.
+     */
+    static SymbolId labelIdOf(TokenType tokenType) {
+        // id + 1 of the label of each type, 0 until interned
+        static std::atomic<SymbolId> labelIds[std::size(LABELS)];
+
+        const int index = static_cast<int>(tokenType) - FIRST_LABELED_TYPE;
+        SymbolId id = labelIds[index].load(std::memory_order_acquire);
+        if (id == 0) {
+            id = Interner::global().intern(LABELS[index]) + 1;
+            labelIds[index].store(id, std::memory_order_release);
+        }
+        return id - 1;
     }
 
-private:
-    TokenType tokenType;
-    string tokenStr;
-    vector<AST *> children;
-    int lineNo;
-};
\ No newline at end of file
+    TokenType tokenType = TokenType::END;
+    SymbolId tokenId = -1;
+    int lineNo = 0;
+    int childCount = 0;
+    AST *const *children = nullptr;
+    Binding binding;
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include "AST.h"
+
+using std::string;
+using std::vector;
+
+/**
+ * @brief Bump allocator of T in chunks
+ *
+ * @details Elements never move, and the n elements of one allocate(n)
+ * are contiguous. T is never destroyed, so it must be trivially
+ * destructible.
+ */
+template <typename T>
+class ChunkedBuffer
+{
+public:
+    T *allocate(int n) {
+        if (chunks.empty() || used + n > capacities.back()) {
+            const int capacity = std::max(CHUNK_SIZE, n);
+            chunks.emplace_back(new T[capacity]);
+            capacities.push_back(capacity);
+            used = 0;
+        }
+        T *first = chunks.back().get() + used;
+        used += n;
+        return first;
+    }
+
+    // free all elements, keeping the first chunk for reuse
+    void clear() {
+        if (chunks.size() > 1) {
+            chunks.resize(1);
+            capacities.resize(1);
+        }
+        used = 0;
+    }
+
+    long long bytes() const {
+        long long capacity = 0;
+        for (int c : capacities) {
+            capacity += c;
+        }
+        return capacity * sizeof(T);
+    }
+
+private:
+    static constexpr int CHUNK_SIZE = 4096;
+
+    vector<std::unique_ptr<T[]>> chunks;
+    vector<int> capacities;
+    int used = 0;
+};
+
+/**
+ * @brief Owner of all nodes of an AST
+ *
+ * @details Nodes are fixed-size and allocated by bumping a pointer; the
+ * children of a node are one contiguous range of pointers. Nothing is
+ * freed node by node: the tree is released with its arena, by dropping
+ * a few chunks.
+ *
+ * Children are collected while their parent is being parsed:
+ *     const int begin = arena.beginChildren();
+ *     arena.pushChild(...);  // nullptr for a missing optional part
+ *     arena.endChildren(node, begin);
+ * Subtrees parsed in between open and end their own lists above begin.
+ */
+class AstArena
+{
+public:
+    // inner node, labeled by its type, e.g. "IfStmt"
+    AST *make(TokenType tokenType, int lineNo) {
+        return new (nodes.allocate(1)) AST(tokenType, lineNo);
+    }
+
+    // leaf of a token, tokenId is its interned text
+    AST *make(const Token &token, SymbolId tokenId) {
+        return new (nodes.allocate(1)) AST(token, tokenId);
+    }
+
+    // operator node, on the line of its first operand
+    AST *make(const Token &token, SymbolId tokenId, int lineNo) {
+        return new (nodes.allocate(1)) AST(token, tokenId, lineNo);
+    }
+
+    int beginChildren() const {
+        return pending.size();
+    }
+
+    void pushChild(AST *child) {
+        pending.push_back(child);
+    }
+
+    void endChildren(AST *node, int begin) {
+        const int count = pending.size() - begin;
+        AST **first = children.allocate(count);
+        std::copy(pending.begin() + begin, pending.end(), first);
+        node->setChildren(first, count);
+        pending.resize(begin);
+    }
+
+    // free the whole AST, to reuse the arena for the next one
+    void clear() {
+        nodes.clear();
+        children.clear();
+        pending.clear();
+        childArenas.clear();
+    }
+
+    /**
+     * @brief An arena freed with this one, for parts of the AST built
+     * apart, e.g. by another thread (an arena is not thread-safe)
+     */
+    AstArena &makeChild() {
+        childArenas.push_back(std::make_unique<AstArena>());
+        return *childArenas.back();
+    }
+
+    long long bytes() const {
+        long long total = nodes.bytes() + children.bytes();
+        for (const auto &childArena : childArenas) {
+            total += childArena->bytes();
+        }
+        return total;
+    }
+
+private:
+    ChunkedBuffer<AST> nodes;
+    ChunkedBuffer<AST *> children;
+
+    // children of the nodes being parsed, innermost last
+    vector<AST *> pending;
+
+    vector<std::unique_ptr<AstArena>> childArenas;
+};
@@ -1,14 +1,56 @@
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <time.h>
+#include <boost/format.hpp>
 #include <boost/program_options.hpp>
 #include "frontend/Lexer.h"
 #include "frontend/Parser.h"
+#include "frontend/TokenStream.h"
 #include "frontend/SemanticAnalyzer.h"
 #include "backend/CodeGenerator.h"
 #include "backend/AssemblyFileIO.h"
+#include "backend/AsmStreamWriter.h"
 #include "ast_vis/AstDumper.h"
+#include "report/PhaseTimer.h"
+#include "report/SizeReport.h"
+#include "SpscQueue.h"
 #include "Compiler.h"
 
+namespace {
+
+// tokens the lexer thread hands over at once
+constexpr int TOKEN_BATCH_SIZE = 4096;
+
+struct TokenBatch {
+    vector<Token> tokens;
+    std::exception_ptr error;
+};
+
+// a Decl and the arena owning it
+struct ParsedDecl {
+    AST *decl = nullptr;
+    std::unique_ptr<AstArena> arena;
+    std::exception_ptr error;
+};
+
+// thrown in a stage when the next one stopped, e.g. on an error
+struct PipelineCancelled {};
+
+long long threadCpuMs()
+{
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec * 1000LL + time.tv_nsec / 1000000;
+}
+
+}
+
 const string Compiler::WELCOME_PROMPT = "Compiler for C-Minus Programming Language. \nOptions";
 
 /**
@@ -25,7 +67,14 @@ bool Compiler::readArgs(int argc, char **argv) {
         ("help,h", "Show help message.")
         (",i", bpo::value<string>(&srcFilePath), "Compile C-Minus source file from <arg> path.")
         (",o", bpo::value<string>(&outputFilePath)->default_value("out.s"), "Output assembly file into <arg> path.")
-        (",v", bpo::value<string>(&visualizeAstFilePath), "Visualize AST. Output the serialized AST JSON file into <arg> path.");
+        (",v", bpo::value<string>(&visualizeAstFilePath), "Visualize AST. Output the serialized AST JSON file into <arg> path.")
+        (",g", bpo::bool_switch(&emitSymbols), "Output function symbols and line table into <output path>.sym.")
+        ("time-report", bpo::bool_switch(&timeReport), "Report wall time, peak RSS growth and object counts of each phase.")
+        ("time-trace", bpo::value<string>(&timeTraceFilePath), "Output phase timings in Chrome trace event format into <arg> path.")
+        ("size-report", bpo::value<string>(&sizeReportFormat)->implicit_value("text"), "Report emitted instructions by function, source construct and source line in <arg> format (text or json).")
+        ("stream", bpo::bool_switch(&streaming), "Compile a top-level declaration at a time, keeping only global symbols and function signatures in memory.")
+        ("pipeline", bpo::bool_switch(&pipelined), "Lex, parse and generate code concurrently, on a thread each, a top-level declaration at a time.")
+        ("jobs,j", bpo::value<int>(&jobs)->default_value(1), "Lex large sources in chunks, parse and generate functions on <arg> threads (0: one per core).");
 
     bpo::variables_map var_map;
 
@@ -52,58 +101,440 @@ bool Compiler::readArgs(int argc, char **argv) {
         return false;
     }
 
+    if (sizeReportFormat.empty() == false && sizeReportFormat != "text" && sizeReportFormat != "json") {
+        std::cerr << "Error: unknown size report format " << sizeReportFormat << "\n";
+        return false;
+    }
+
+    if (jobs < 0) {
+        std::cerr << "Error: jobs must not be negative\n";
+        return false;
+    }
+
+    if (streaming && (visualizeAstFilePath.empty() == false || sizeReportFormat.empty() == false || jobs != 1)) {
+        std::cerr << "Error: --stream cannot be used with -v, --size-report or -j\n";
+        return false;
+    }
+
+    if (pipelined && (visualizeAstFilePath.empty() == false || sizeReportFormat.empty() == false || jobs != 1 || streaming)) {
+        std::cerr << "Error: --pipeline cannot be used with -v, --size-report, -j or --stream\n";
+        return false;
+    }
+
     return true;
 }
 
 void Compiler::compile() const {
-    if (srcFilePath.empty() == false) {
+    if (srcFilePath.empty() == false && streaming) {
+        compileStreaming();
+    } else if (srcFilePath.empty() == false && pipelined) {
+        compilePipelined();
+    } else if (srcFilePath.empty() == false) {
+        PhaseTimer timer;
+
+        // no thread but the main one unless -j
+        std::unique_ptr<ThreadPool> pool;
+        if (jobs != 1) {
+            pool = std::make_unique<ThreadPool>(jobs);
+        }
+
+        // the source is only mapped, lexed by a later phase
+        timer.begin("Source");
         Lexer lexer(srcFilePath);
-        auto tokens = lexer.lexicalAnalysis();
+        timer.end({{"source KB", lexer.getSource().size() / 1024}});
 
-        std::cout << "[√] Lexing Complete!\n";
+        vector<Token> tokens;
+        if (pool != nullptr) {
+            timer.begin("Lexer");
+            tokens = lexer.parallelLexicalAnalysis(*pool);
+            timer.end({{"tokens", tokens.size()}});
+        }
 
-        Parser parser(tokens);
-        auto astRoot = parser.syntaxAnalysis();
+        // unless lexed in parallel, tokens are lexed as the parser pulls them
+        timer.begin(pool == nullptr ? "Lexer+Parser" : "Parser");
+        TokenStream tokenStream = tokens.empty() ? TokenStream(lexer) : TokenStream(lexer, tokens);
+        AstArena astArena;
+        Parser parser(tokenStream, astArena);
+        AST *astRoot = nullptr;
+        vector<SemanticAnalyzer::Locals> declLocals;
+        if (pool == nullptr) {
+            astRoot = parser.syntaxAnalysis();
+        } else {
+            // a function is declared by the thread that parsed it
+            const vector<size_t> declStarts = Parser::findDecls(tokens);
+            declLocals.resize(declStarts.empty() ? 0 : declStarts.size() - 1);
+            astRoot = parser.parallelSyntaxAnalysis(declStarts, *pool, [&declLocals](size_t i, AST *decl) {
+                if (decl->getTokenType() == TokenType::FUNC_DECL) {
+                    declLocals.at(i) = SemanticAnalyzer::declareLocals(decl);
+                }
+            });
+            if (declLocals.size() != astRoot->getChildren().size()) {
+                declLocals.clear();
+            }
+        }
+        timer.end({{"tokens", pool == nullptr ? tokenStream.getTokenCount() + 1 : tokens.size()},
+                   {"AST nodes", AST::countNodes(astRoot)}, {"arena KB", astArena.bytes() / 1024}});
+
+        std::cout << "[√] Lexing Complete!\n";
 
         if (visualizeAstFilePath.empty() == false) {
+            timer.begin("AstDumper");
             Json::Value json = AstDumper::dump(astRoot);
             std::ofstream writeJson(visualizeAstFilePath);
             writeJson << json;
+            timer.end();
         }
 
         std::cout << "[√] Parsing Complete!\n";
 
+        timer.begin("SemanticAnalyzer");
         SemanticAnalyzer semanticAnalyzer(astRoot);
-        semanticAnalyzer.semanticAnalysis();
+        semanticAnalyzer.semanticAnalysis(declLocals);
         const auto &symbolTable = semanticAnalyzer.getSymbolTable();
 
-        std::cout << "[√] Semantic Analysis Complete!\n";
+        long long symbolCount = 0;
+        for (const Scope &scope : symbolTable) {
+            symbolCount += scope.variables.size();
+        }
+        timer.end({{"scopes", symbolTable.size()}, {"symbols", symbolCount}});
 
-        // for (const auto &[k, v] : symbolTable) {
-        //     std::cout << k << ": ";
-        //     for (const auto &[k1, v1] : v) {
-        //         std::cout << k1 << ": {";
-        //         std::cout << v1.variableIndex << " "
-        //                   << v1.variableType << " "
-        //                   << v1.varSize << "}\n";
-        //     }
-        //     std::cout << "\n";
-        // }
+        std::cout << "[√] Semantic Analysis Complete!\n";
 
+        timer.begin("CodeGenerator");
         CodeGenerator codeGenerator(astRoot, symbolTable);
-        auto insts = codeGenerator.generate();
+        auto insts = pool == nullptr ? codeGenerator.generate() : codeGenerator.generate(*pool);
+        timer.end({{"instructions", insts.size()}});
 
         std::cout << "[√] Generate Code Complete!\n";
 
+        timer.begin("writeAsmFile");
         AssemblyFileIO::writeAsmFile(outputFilePath, insts);
+        if (emitSymbols) {
+            AssemblyFileIO::writeSymbolFile(SymbolMap::defaultPathOf(outputFilePath),
+                                            codeGenerator.getFuncSymbols(), insts);
+        }
+        timer.end();
 
         std::cout << "[√] Write Assembly File Complete!\n";
 
-
-        AST::destroyChildrenRecursively(astRoot);
-        delete astRoot;
+        if (timeReport) {
+            timer.print(std::cout);
+        }
+        if (timeTraceFilePath.empty() == false) {
+            std::ofstream writeJson(timeTraceFilePath);
+            writeJson << timer.toChromeTrace();
+        }
+        if (sizeReportFormat.empty() == false) {
+            SizeReport sizeReport(insts, codeGenerator.getFuncSymbols(), srcFilePath);
+            if (sizeReportFormat == "json") {
+                std::cout << sizeReport.toJson() << "\n";
+            } else {
+                sizeReport.print(std::cout);
+            }
+        }
     } else {
         std::cerr << "Fatal error: no input files.\n";
     }
 }
 
+/**
+ * @brief Compile the source in two passes over its top-level declarations
+ *
+ * @details The AST of a declaration is freed as soon as it is used.
+ * 1. Declare: every Decl is parsed and declared, so that the symbol
+ *    table holds the globals and the frame of every function (a caller
+ *    pushes the locals of its callee), but not the locals themselves.
+ * 2. Generate: every FuncDecl is parsed again, its locals declared
+ *    again, then resolved, generated and written. The AST of main() is
+ *    kept apart until the others are written, as it is the last function.
+ * Calls to functions not written yet are patched in the file at last.
+ */
+void Compiler::compileStreaming() const {
+    PhaseTimer timer;
+
+    timer.begin("Source");
+    Lexer lexer(srcFilePath);
+    timer.end({{"source KB", lexer.getSource().size() / 1024}});
+
+    AstArena astArena;
+    SemanticAnalyzer semanticAnalyzer;
+    const auto &symbolTable = semanticAnalyzer.getSymbolTable();
+
+    timer.begin("Declare");
+    long long tokenCount = 0;
+    long long declCount = 0;
+    {
+        TokenStream tokenStream(lexer);
+        Parser parser(tokenStream, astArena);
+        semanticAnalyzer.beginDeclarations();
+        while (AST *decl = parser.nextDecl()) {
+            semanticAnalyzer.declareDecl(decl, false);
+            astArena.clear();
+            declCount++;
+        }
+        tokenCount = tokenStream.getTokenCount() + 1;
+    }
+    timer.end({{"tokens", tokenCount}, {"decls", declCount}, {"scopes", symbolTable.size()}});
+
+    std::cout << "[√] Declarations Complete!\n";
+
+    const int mainScope = semanticAnalyzer.scopeOf(Interner::global().intern(MAIN_NAME));
+    if (mainScope == -1) {
+        throw std::runtime_error("id main not found in symbol table!");
+    }
+
+    timer.begin("Generate");
+    AsmStreamWriter writer(outputFilePath, emitSymbols ? SymbolMap::defaultPathOf(outputFilePath) : "");
+    CodeGenerator codeGenerator(nullptr, symbolTable);
+    codeGenerator.generatePrelude(mainScope);
+    codeGenerator.flush(writer);
+
+    long long maxArenaBytes = 0;
+    auto generateFunction = [&](AST *decl, int scope, AstArena &arena) {
+        semanticAnalyzer.redeclareLocals(decl, scope);
+        semanticAnalyzer.resolveFunction(decl, scope);
+        codeGenerator.generateFunction(decl);
+        codeGenerator.flush(writer);
+        semanticAnalyzer.dropLocals(scope);
+        maxArenaBytes = std::max(maxArenaBytes, arena.bytes());
+        arena.clear();
+    };
+
+    AstArena mainArena;
+    AST *mainDecl = nullptr;
+    {
+        TokenStream tokenStream(lexer);
+        Parser parser(tokenStream, astArena);
+        int scope = 0;
+        while (AST *decl = parser.nextDecl()) {
+            if (decl->getTokenType() != TokenType::FUNC_DECL) {
+                astArena.clear();
+            } else if (++scope == mainScope) {
+                // the parser goes on in the emptied arena
+                std::swap(astArena, mainArena);
+                mainDecl = decl;
+            } else {
+                generateFunction(decl, scope, astArena);
+            }
+        }
+    }
+    generateFunction(mainDecl, mainScope, mainArena);
+
+    codeGenerator.linkWritten(writer);
+    writer.finish(codeGenerator.getFuncSymbols());
+    timer.end({{"instructions", writer.size()}, {"max arena KB", maxArenaBytes / 1024},
+               {"asm KB", writer.bytes() / 1024}});
+
+    std::cout << "[√] Generate Code Complete!\n";
+    std::cout << "[√] Write Assembly File Complete!\n";
+
+    if (timeReport) {
+        timer.print(std::cout);
+    }
+    if (timeTraceFilePath.empty() == false) {
+        std::ofstream writeJson(timeTraceFilePath);
+        writeJson << timer.toChromeTrace();
+    }
+}
+
+/**
+ * @brief Compile the source by 3 concurrent stages, connected by
+ * lock-free single-producer single-consumer queues
+ *
+ * @details
+ * 1. Lexer thread: tokens, in batches of TOKEN_BATCH_SIZE.
+ * 2. Parser thread: pulls the batches and parses a Decl at a time, each
+ *    into its own arena, handed over with the Decl.
+ * 3. This thread: declares every Decl as it comes, then resolves,
+ *    generates and writes the functions in source order. A function
+ *    using a name not declared yet waits (with the ones after it) for
+ *    that name. The prelude needs all globals, so the code starts with
+ *    a jump to the prelude, written after the other functions, right
+ *    before main().
+ * An error in a stage is handed over to the next one, and rethrown here.
+ */
+void Compiler::compilePipelined() const {
+    PhaseTimer timer;
+
+    timer.begin("Source");
+    Lexer lexer(srcFilePath);
+    timer.end({{"source KB", lexer.getSource().size() / 1024}});
+
+    timer.begin("Pipeline");
+    const long long startCpuMs = threadCpuMs();
+
+    AsmStreamWriter writer(outputFilePath, emitSymbols ? SymbolMap::defaultPathOf(outputFilePath) : "");
+    SemanticAnalyzer semanticAnalyzer;
+    semanticAnalyzer.beginDeclarations();
+    CodeGenerator codeGenerator(nullptr, semanticAnalyzer.getSymbolTable());
+    codeGenerator.generateEntryJump();
+    codeGenerator.flush(writer);
+
+    SpscQueue<TokenBatch> tokenQueue(16);
+    SpscQueue<ParsedDecl> declQueue(64);
+    long long tokenCount = 0;
+    long long lexerCpuMs = 0;
+    long long parserCpuMs = 0;
+
+    std::thread lexerThread([&] {
+        const char *textPtr = lexer.getSource().data();
+        int lineNo = 1;
+        try {
+            for (bool end = false; end == false;) {
+                TokenBatch batch;
+                batch.tokens.reserve(TOKEN_BATCH_SIZE);
+                end = lexer.lexBatch(textPtr, lineNo, TOKEN_BATCH_SIZE, batch.tokens);
+                tokenCount += batch.tokens.size();
+                if (tokenQueue.push(std::move(batch)) == false) {
+                    break;
+                }
+            }
+        } catch (...) {
+            TokenBatch failed;
+            failed.error = std::current_exception();
+            tokenQueue.push(std::move(failed));
+        }
+        tokenQueue.close();
+        lexerCpuMs = threadCpuMs();
+    });
+
+    std::thread parserThread([&] {
+        try {
+            TokenStream tokenStream(lexer, [&tokenQueue](vector<Token> &tokens) {
+                TokenBatch batch;
+                if (tokenQueue.pop(batch) == false) {
+                    throw PipelineCancelled();
+                }
+                if (batch.error) {
+                    std::rethrow_exception(batch.error);
+                }
+                tokens = std::move(batch.tokens);
+            });
+            AstArena arena;
+            Parser parser(tokenStream, arena);
+            while (AST *decl = parser.nextDecl()) {
+                // the Decl takes the nodes along, the parser goes on in an empty arena
+                ParsedDecl parsed{decl, std::make_unique<AstArena>(std::move(arena)), {}};
+                arena = AstArena();
+                if (declQueue.push(std::move(parsed)) == false) {
+                    break;
+                }
+            }
+        } catch (const PipelineCancelled &) {
+        } catch (...) {
+            ParsedDecl failed;
+            failed.error = std::current_exception();
+            declQueue.push(std::move(failed));
+        }
+        declQueue.close();
+        parserCpuMs = threadCpuMs();
+    });
+
+    const SymbolId mainId = Interner::global().intern(MAIN_NAME);
+    long long declCount = 0;
+    size_t maxWaiting = 0;
+
+    // functions declared but not generated yet, in source order
+    std::deque<ParsedDecl> waiting;
+    // a name used by waiting.front() but not declared yet, -1 if none
+    SymbolId waitingFor = -1;
+    // resolved, generated last
+    ParsedDecl mainDecl;
+
+    auto generateResolved = [&](ParsedDecl &parsed) {
+        if (parsed.decl->getChildren().at(1)->getTokenId() == mainId) {
+            mainDecl = std::move(parsed);
+        } else {
+            codeGenerator.generateFunction(parsed.decl);
+            codeGenerator.flush(writer);
+        }
+    };
+
+    auto generateReady = [&] {
+        for (; waiting.empty() == false; waiting.pop_front()) {
+            AST *const decl = waiting.front().decl;
+            const int scope = decl->getChildren().at(1)->getBinding().index;
+            if (const AST *idNode = semanticAnalyzer.tryResolveFunction(decl, scope)) {
+                waitingFor = idNode->getTokenId();
+                return;
+            }
+            generateResolved(waiting.front());
+        }
+        waitingFor = -1;
+    };
+
+    try {
+        ParsedDecl parsed;
+        while (declQueue.pop(parsed)) {
+            if (parsed.error) {
+                std::rethrow_exception(parsed.error);
+            }
+            declCount++;
+
+            // Decl -> VariableDecl | FuncDecl, both are Type id ...
+            AST *const decl = parsed.decl;
+            const SymbolId name = decl->getChildren().at(1)->getTokenId();
+            if (decl->getTokenType() == TokenType::FUNC_DECL) {
+                // a call may already be bound to the first one
+                if (semanticAnalyzer.scopeOf(name) != -1) {
+                    throw std::runtime_error((
+                        boost::format("function %s redeclared, not supported by --pipeline") % decl->getChildren().at(1)->getTokenStr())
+                    .str());
+                }
+                semanticAnalyzer.declareDecl(decl);
+                waiting.push_back(std::move(parsed));
+                maxWaiting = std::max(maxWaiting, waiting.size());
+            } else {
+                semanticAnalyzer.declareDecl(decl);
+            }
+
+            if (waitingFor == -1 || waitingFor == name) {
+                generateReady();
+            }
+        }
+    } catch (...) {
+        tokenQueue.cancel();
+        declQueue.cancel();
+        lexerThread.join();
+        parserThread.join();
+        throw;
+    }
+    lexerThread.join();
+    parserThread.join();
+
+    // every name is declared by now, or never will be
+    for (ParsedDecl &parsed : waiting) {
+        AST *const decl = parsed.decl;
+        semanticAnalyzer.resolveFunction(decl, decl->getChildren().at(1)->getBinding().index);
+        generateResolved(parsed);
+    }
+    waiting.clear();
+
+    if (mainDecl.decl == nullptr) {
+        throw std::runtime_error("id main not found in symbol table!");
+    }
+    codeGenerator.generateLatePrelude(semanticAnalyzer.scopeOf(mainId));
+    codeGenerator.generateFunction(mainDecl.decl);
+    codeGenerator.flush(writer);
+
+    codeGenerator.linkWritten(writer);
+    writer.finish(codeGenerator.getFuncSymbols());
+    timer.end({{"tokens", tokenCount}, {"decls", declCount}, {"max waiting functions", maxWaiting},
+               {"instructions", writer.size()}, {"asm KB", writer.bytes() / 1024},
+               {"lexer CPU ms", lexerCpuMs}, {"parser CPU ms", parserCpuMs},
+               {"codegen CPU ms", threadCpuMs() - startCpuMs}});
+
+    std::cout << "[√] Lexing Complete!\n";
+    std::cout << "[√] Parsing Complete!\n";
+    std::cout << "[√] Semantic Analysis Complete!\n";
+    std::cout << "[√] Generate Code Complete!\n";
+    std::cout << "[√] Write Assembly File Complete!\n";
+
+    if (timeReport) {
+        timer.print(std::cout);
+    }
+    if (timeTraceFilePath.empty() == false) {
+        std::ofstream writeJson(timeTraceFilePath);
+        writeJson << timer.toChromeTrace();
+    }
+}
@@ -16,10 +16,28 @@ public:
     void compile() const;
 
 private:
+    // a top-level declaration at a time, see --stream
+    void compileStreaming() const;
+
+    // lexer, parser and code generator on threads of their own, see --pipeline
+    void compilePipelined() const;
+
     string srcFilePath;
     string outputFilePath;
     string asmFilePath;
     string visualizeAstFilePath;
+    bool emitSymbols = false;
+
+    bool timeReport = false;
+    string timeTraceFilePath;
+
+    string sizeReportFormat;
+
+    bool streaming = false;
+    bool pipelined = false;
+
+    // threads, 0: one per core
+    int jobs = 1;
 
     const static string WELCOME_PROMPT;
 };
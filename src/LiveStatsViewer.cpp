@@ -0,0 +1,118 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "backend/SymbolMap.h"
+#include "runtime/LiveStatsPage.h"
+#include "LiveStatsViewer.h"
+
+const string LiveStatsViewer::WELCOME_PROMPT = "Live counters of a running C-Minus VM (cm --live-stats). \nOptions";
+
+bool LiveStatsViewer::readArgs(int argc, char **argv) {
+    namespace bpo = boost::program_options;
+
+    bpo::options_description desc(WELCOME_PROMPT);
+    desc.add_options()
+        ("help,h", "Show help message.")
+        ("file,f", bpo::value<string>(&statsFilePath), "Read live stats file from <arg> path.")
+        ("symbols", bpo::value<string>(&symbolFilePath), "Read function symbols from <arg> path.")
+        ("interval,n", bpo::value<int>(&intervalMs)->default_value(1000), "Refresh every <arg> milliseconds.")
+        ("once", bpo::bool_switch(&once), "Print the counters once and exit.");
+
+    bpo::positional_options_description positional;
+    positional.add("file", 1);
+
+    bpo::variables_map var_map;
+    try {
+        bpo::store(bpo::command_line_parser(argc, argv).options(desc).positional(positional).run(), var_map);
+
+        if (var_map.find("help") != var_map.end()) {
+            std::cout << desc << "\n";
+            return false;
+        }
+
+        bpo::notify(var_map);
+    } catch (std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return false;
+    } catch (...) {
+        std::cerr << "Unknown error during readArgs! \n";
+        return false;
+    }
+
+    if (statsFilePath.empty()) {
+        std::cout << desc << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+void LiveStatsViewer::view() const {
+    const int fd = open(statsFilePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: cannot open " << statsFilePath << "\n";
+        return;
+    }
+    // mapping past the end of a short file would fault (SIGBUS) on read
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(sizeof(LiveStatsPage))) {
+        std::cerr << "Error: " << statsFilePath << " is not a live stats file\n";
+        close(fd);
+        return;
+    }
+    void *addr = mmap(nullptr, sizeof(LiveStatsPage), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        std::cerr << "Error: cannot map " << statsFilePath << "\n";
+        return;
+    }
+    const LiveStatsPage *page = static_cast<const LiveStatsPage *>(addr);
+
+    if (page->magic.load(std::memory_order_acquire) != LIVE_STATS_MAGIC || page->version != LIVE_STATS_VERSION) {
+        std::cerr << "Error: " << statsFilePath << " is not a live stats file\n";
+        munmap(addr, sizeof(LiveStatsPage));
+        return;
+    }
+
+    SymbolMap symbolMap(symbolFilePath);
+    const auto relaxed = std::memory_order_relaxed;
+
+    std::cout << boost::format("%-8s %14s %12s %8s %-20s %6s %10s %10s %10s\n")
+        % "state" % "instructions" % "inst/s" % "pc" % "function" % "depth" % "stack" % "in bytes" % "out bytes";
+
+    uint64_t lastInstCount = page->instCount.load(relaxed);
+    auto lastTime = std::chrono::steady_clock::now();
+    while (true) {
+        if (once == false) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+        }
+
+        const uint32_t state = page->state.load(std::memory_order_acquire);
+        const bool finished = state == LIVE_STATS_FINISHED || state == LIVE_STATS_FAILED;
+        const uint64_t instCount = page->instCount.load(relaxed);
+        const auto now = std::chrono::steady_clock::now();
+        const double seconds = std::chrono::duration<double>(now - lastTime).count();
+
+        std::cout << boost::format("%-8s %14d %12.0f %8d %-20s %6d %10d %10d %10d\n")
+            % (state == LIVE_STATS_FINISHED ? "done" : state == LIVE_STATS_FAILED ? "failed" : "running") % instCount
+            % (seconds > 0 ? (instCount - lastInstCount) / seconds : 0.0)
+            % page->pc.load(relaxed) % symbolMap.getFuncName(page->funcEntry.load(relaxed))
+            % page->callDepth.load(relaxed) % page->stackWords.load(relaxed)
+            % page->bytesRead.load(relaxed) % page->bytesWritten.load(relaxed);
+        std::cout.flush();
+
+        if (finished || once) {
+            break;
+        }
+        lastInstCount = instCount;
+        lastTime = now;
+    }
+
+    munmap(addr, sizeof(LiveStatsPage));
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+using std::string;
+
+class LiveStatsViewer
+{
+public:
+    LiveStatsViewer() {}
+
+    bool readArgs(int argc, char **argv);
+    void view() const;
+
+private:
+    string statsFilePath;
+    string symbolFilePath;
+    int intervalMs = 1000;
+    bool once = false;
+
+    const static string WELCOME_PROMPT;
+};
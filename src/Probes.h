@@ -0,0 +1,37 @@
+#pragma once
+
+/*
+USDT probes (provider `cminus`), e.g.
+    bpftrace -e 'usdt:./cm:cminus:call { @[arg1] = count(); }'
+
+Compiler (cmc):
+    phase__start(const char *phaseName)
+    phase__end(const char *phaseName)
+
+VM (cm):
+    run__start(int codeSize)
+    run__end(int pc)
+    call(int pc, int target)   before the call
+    ret(int pc, int callPc)    before the ret, callPc is the pc of the matching call
+    in(int value)              after the read
+    out(int value)             before the write
+
+A probe is a single nop plus an ELF note until a tracer attaches to it.
+Without <sys/sdt.h> (systemtap-sdt-dev), or built with -DENABLE_PROBES=OFF,
+probes compile to nothing.
+*/
+
+#if defined(__has_include) && !defined(CMINUS_NO_PROBES)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define CMINUS_PROBES_ENABLED 1
+#endif
+#endif
+
+#ifdef CMINUS_PROBES_ENABLED
+#define CMINUS_PROBE1(name, arg1) DTRACE_PROBE1(cminus, name, arg1)
+#define CMINUS_PROBE2(name, arg1, arg2) DTRACE_PROBE2(cminus, name, arg1, arg2)
+#else
+#define CMINUS_PROBE1(name, arg1) do {} while (0)
+#define CMINUS_PROBE2(name, arg1, arg2) do {} while (0)
+#endif
@@ -1,7 +1,17 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
 #include <boost/program_options.hpp>
 #include "backend/AssemblyFileIO.h"
 #include "backend/VM.h"
+#include "backend/SymbolMap.h"
+#include "runtime/SamplingProfiler.h"
+#include "runtime/RunStats.h"
+#include "runtime/CountingStreamBuf.h"
+#include "runtime/TraceRecorder.h"
+#include "runtime/LiveStatsPublisher.h"
+#include "runtime/BenchRunner.h"
 #include "Runtime.h"
 
 const string Runtime::WELCOME_PROMPT = "VM for C-Minus Programming Language. \nOptions";
@@ -12,7 +22,19 @@ bool Runtime::readArgs(int argc, char **argv) {
     bpo::options_description desc(WELCOME_PROMPT);
     desc.add_options()
         ("help,h", "Show help message.")
-        ("run,r", bpo::value<string>(&asmFilePath), "Run assembly file with VM from <arg> path.");
+        ("run,r", bpo::value<string>(&asmFilePath), "Run assembly file with VM from <arg> path.")
+        ("symbols", bpo::value<string>(&symbolFilePath), "Read function symbols from <arg> path. Default is <assembly file>.sym.")
+        ("sample-hz", bpo::value<int>(&sampleHz), "Sample the call stack <arg> times per CPU second.")
+        ("sample-out", bpo::value<string>(&foldedFilePath)->default_value("profile.folded"), "Output sampled stacks (folded format) into <arg> path.")
+        ("stats", bpo::value<string>(&statsFormat)->implicit_value("text"), "Report resource usage of the run in <arg> format (text or json).")
+        ("stats-out", bpo::value<string>(&statsFilePath), "Output the resource usage report into <arg> path instead of stderr.")
+        ("trace", bpo::value<string>(&traceFilePath), "Record branches, calls and returns into binary trace file <arg>.")
+        ("trace-ring", bpo::value<size_t>(&traceRingSize), "Only keep the last <arg> trace events.")
+        ("live-stats", bpo::value<string>(&liveStatsFilePath), "Publish live counters into mmap'd file <arg> (read it with cmstat).")
+        ("bench", bpo::value<string>(&benchFormat)->implicit_value("text"), "Run the program repeatedly on the same input and report run times in <arg> format (text or json).")
+        ("repeat", bpo::value<int>(&benchRepeat)->default_value(10), "Timed runs of --bench.")
+        ("warmup", bpo::value<int>(&benchWarmup)->default_value(1), "Untimed runs of --bench before the timed ones.")
+        ("bench-output", bpo::value<string>(&benchOutput)->default_value("hash"), "Output of --bench runs: hash or discard.");
 
     bpo::variables_map var_map;
     try {
@@ -37,16 +59,169 @@ bool Runtime::readArgs(int argc, char **argv) {
         return false;
     }
 
+    if (var_map.count("sample-hz") != 0 && sampleHz <= 0) {
+        std::cerr << "Error: --sample-hz must be positive\n";
+        return false;
+    }
+    if (sampleHz > SamplingProfiler::MAX_SAMPLE_HZ) {
+        std::cerr << "Error: --sample-hz must be at most " << SamplingProfiler::MAX_SAMPLE_HZ << "\n";
+        return false;
+    }
+
+    if (statsFormat.empty() == false && statsFormat != "text" && statsFormat != "json") {
+        std::cerr << "Error: unknown stats format " << statsFormat << "\n";
+        return false;
+    }
+
+    if (benchFormat.empty() == false) {
+        if (benchFormat != "text" && benchFormat != "json") {
+            std::cerr << "Error: unknown bench format " << benchFormat << "\n";
+            return false;
+        }
+        if (benchOutput != "hash" && benchOutput != "discard") {
+            std::cerr << "Error: unknown bench output " << benchOutput << "\n";
+            return false;
+        }
+        if (benchRepeat <= 0) {
+            std::cerr << "Error: --repeat must be positive\n";
+            return false;
+        }
+        if (benchWarmup < 0) {
+            std::cerr << "Error: --warmup must not be negative\n";
+            return false;
+        }
+        if (sampleHz > 0 || statsFormat.empty() == false || traceFilePath.empty() == false || liveStatsFilePath.empty() == false) {
+            std::cerr << "Error: --bench cannot be combined with --sample-hz, --stats, --trace or --live-stats\n";
+            return false;
+        }
+    }
+
     return true;
 }
 
-void Runtime::execCode() const {
+bool Runtime::execCode() const {
     if (asmFilePath.empty() == false) {
         auto codes = AssemblyFileIO::readAsmFile(asmFilePath);
 
+        if (benchFormat.empty() == false) {
+            return benchCode(codes);
+        }
+
+        SymbolMap symbolMap(symbolFilePath.empty() ? SymbolMap::defaultPathOf(asmFilePath) : symbolFilePath);
+
         VM vm(codes);
-        vm.run();
+
+        SamplingProfiler profiler(sampleHz);
+        if (sampleHz > 0) {
+            vm.addMonitor(&profiler);
+        }
+
+        // count I/O bytes between the VM and the standard streams
+        CountingStreamBuf inputBuf(std::cin.rdbuf()), outputBuf(std::cout.rdbuf());
+        std::istream countedInput(&inputBuf);
+        std::ostream countedOutput(&outputBuf);
+
+        TraceRecorder traceRecorder(traceFilePath, traceRingSize);
+        if (traceFilePath.empty() == false) {
+            vm.addMonitor(&traceRecorder);
+        }
+
+        if (statsFormat.empty() == false || liveStatsFilePath.empty() == false) {
+            vm.setIO(countedInput, countedOutput);
+        }
+
+        RunStats stats;
+        if (statsFormat.empty() == false) {
+            vm.addMonitor(&stats);
+        }
+
+        LiveStatsPublisher liveStatsPublisher(liveStatsFilePath, inputBuf, outputBuf);
+        if (liveStatsFilePath.empty() == false) {
+            vm.addMonitor(&liveStatsPublisher);
+        }
+
+        // output files are opened before the run, a bad path is no runtime error
+        std::ofstream foldedFile;
+        try {
+            if (sampleHz > 0) {
+                foldedFile.open(foldedFilePath);
+                if (foldedFile.is_open() == false) {
+                    throw std::runtime_error("Cannot open profile file " + foldedFilePath);
+                }
+            }
+            if (traceFilePath.empty() == false) {
+                traceRecorder.open();
+            }
+            if (liveStatsFilePath.empty() == false) {
+                liveStatsPublisher.open(vm);
+            }
+        } catch (std::exception &e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return false;
+        }
+
+        bool failed = false;
+        try {
+            vm.run();
+        } catch (std::exception &e) {
+            const int pc = vm.getPc();
+            std::cerr << "Runtime error: " << e.what() << " at pc " << pc
+                      << " (" << symbolMap.getLocation(pc) << ")\n";
+            failed = true;
+        }
+
+        // a profile of a failed run tells where it spent its time as well
+        if (sampleHz > 0) {
+            profiler.writeFoldedStacks(foldedFile, symbolMap);
+        }
+
+        if (failed) {
+            return false;
+        }
+
+        if (statsFormat.empty() == false) {
+            countedOutput.flush();
+            stats.setIOBytes(inputBuf.getCount(), outputBuf.getCount());
+            reportStats(stats);
+        }
+        return true;
     } else {
         std::cerr << "Fatal error: no input files.\n";
+        return false;
+    }
+}
+
+void Runtime::reportStats(const RunStats &stats) const {
+    std::ofstream writeFile;
+    if (statsFilePath.empty() == false) {
+        writeFile.open(statsFilePath);
+    }
+    std::ostream &out = statsFilePath.empty() ? std::cerr : writeFile;
+
+    if (statsFormat == "json") {
+        out << stats.toJson() << "\n";
+    } else {
+        stats.print(out);
+    }
+}
+
+bool Runtime::benchCode(const vector<VMInst> &codes) const {
+    // capture stdin once, every run replays it
+    std::ostringstream input;
+    input << std::cin.rdbuf();
+
+    BenchRunner benchRunner(codes, benchWarmup, benchRepeat, benchOutput == "hash");
+    try {
+        benchRunner.run(input.str());
+    } catch (std::exception &e) {
+        std::cerr << "Runtime error: " << e.what() << "\n";
+        return false;
+    }
+
+    if (benchFormat == "json") {
+        std::cout << benchRunner.toJson() << "\n";
+    } else {
+        benchRunner.print(std::cout);
     }
-}
\ No newline at end of file
+    return true;
+}
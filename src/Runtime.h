@@ -1,8 +1,13 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include "backend/VMInst.h"
 
 using std::string;
+using std::vector;
+
+class RunStats;
 
 class Runtime
 {
@@ -10,10 +15,31 @@ public:
     Runtime() {}
 
     bool readArgs(int argc, char **argv);
-    void execCode() const;
+    // false if the program could not be run or failed
+    bool execCode() const;
     
 private:
     string asmFilePath;
+    string symbolFilePath;
+
+    int sampleHz = 0;
+    string foldedFilePath;
+
+    string statsFormat;
+    string statsFilePath;
+
+    string traceFilePath;
+    size_t traceRingSize = 0;
+
+    string liveStatsFilePath;
+
+    string benchFormat;
+    int benchRepeat = 0;
+    int benchWarmup = 0;
+    string benchOutput;
+
+    void reportStats(const RunStats &stats) const;
+    bool benchCode(const vector<VMInst> &codes) const;
 
     const static string WELCOME_PROMPT;
 };
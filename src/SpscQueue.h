@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Bounded lock-free queue between one producer thread and one
+ * consumer thread
+ *
+ * @details A ring of slots indexed by two counters, each written by one
+ * side only. A full push() / an empty pop() waits by yielding, then by
+ * short sleeps so that a stalled side doesn't burn a core. The
+ * producer close()s the queue after its last item; either side may
+ * cancel() it, e.g. on an error, which makes both sides return false.
+ */
+template <typename T>
+class SpscQueue
+{
+public:
+    // capacity is rounded up to a power of 2
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size *= 2;
+        }
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    // producer, false if cancelled
+    bool push(T &&item) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        int spins = 0;
+        while (t - head.load(std::memory_order_acquire) == slots.size()) {
+            if (cancelled.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            wait(spins);
+        }
+        slots[t & mask] = std::move(item);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer, false once closed and empty, or if cancelled
+    bool pop(T &item) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        int spins = 0;
+        while (h == tail.load(std::memory_order_acquire)) {
+            if (cancelled.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            // closed after its last push: empty for good
+            if (closed.load(std::memory_order_acquire) && h == tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            wait(spins);
+        }
+        item = std::move(slots[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // producer, after its last push
+    void close() {
+        closed.store(true, std::memory_order_release);
+    }
+
+    void cancel() {
+        cancelled.store(true, std::memory_order_relaxed);
+    }
+
+private:
+    static void wait(int &spins) {
+        if (spins++ < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    std::vector<T> slots;
+    size_t mask;
+
+    // next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> head{0};
+    // next slot to push, written by the producer
+    alignas(64) std::atomic<size_t> tail{0};
+
+    std::atomic<bool> closed{false};
+    std::atomic<bool> cancelled{false};
+};
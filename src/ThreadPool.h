@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed set of worker threads running tasks in FIFO order
+ *
+ * @details A pool of one thread runs parallelFor() inline, so a
+ * sequential build pays nothing for it.
+ */
+class ThreadPool
+{
+public:
+    // threadCount 0: one thread per core
+    explicit ThreadPool(int threadCount = 0) {
+        if (threadCount <= 0) {
+            threadCount = defaultThreadCount();
+        }
+        for (int i = 0; i < threadCount; i++) {
+            workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    int size() const {
+        return workers.size();
+    }
+
+    static int defaultThreadCount() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // run func() on a worker
+    template <typename Func>
+    auto submit(Func func) -> std::future<decltype(func())> {
+        using Result = decltype(func());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(func));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace([task] { (*task)(); });
+        }
+        wakeUp.notify_one();
+        return result;
+    }
+
+    /**
+     * @brief Call func(i) for every i in [0, n) and wait for all
+     * @details The first exception thrown (by index) is rethrown, once
+     * all calls are done.
+     */
+    template <typename Func>
+    void parallelFor(size_t n, Func func) {
+        if (size() <= 1 || n <= 1) {
+            for (size_t i = 0; i < n; i++) {
+                func(i);
+            }
+            return;
+        }
+
+        std::vector<std::future<void>> results;
+        results.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            results.push_back(submit([&func, i] { func(i); }));
+        }
+
+        std::exception_ptr error;
+        for (auto &result : results) {
+            try {
+                result.get();
+            } catch (...) {
+                if (error == nullptr) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error != nullptr) {
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::queue<std::function<void()>> tasks;
+    bool stopping = false;
+
+    void work() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeUp.wait(lock, [this] { return stopping || tasks.empty() == false; });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+};
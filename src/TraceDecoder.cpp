@@ -0,0 +1,334 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <cstring>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include "backend/AssemblyFileIO.h"
+#include "backend/SymbolMap.h"
+#include "runtime/TraceFormat.h"
+#include "TraceDecoder.h"
+
+using std::vector;
+using std::unordered_map;
+
+const string TraceDecoder::WELCOME_PROMPT = "Execution trace decoder for C-Minus VM. \nOptions";
+
+namespace {
+
+struct FuncAccount {
+    long long calls = 0;
+    long long selfInsts = 0;
+    long long totalInsts = 0;
+    int activeCount = 0; // recursion guard for totalInsts
+};
+
+struct Frame {
+    int entry;
+    int callPc;
+    long long enterTime;
+};
+
+// entry offset of an unknown function (bottom of a ring trace)
+const int UNKNOWN_ENTRY = -1;
+
+vector<uint32_t> readTraceFile(const string &traceFilePath, TraceHeader &header)
+{
+    std::ifstream readFile(traceFilePath, std::ios::binary);
+    if (readFile.read(reinterpret_cast<char *>(&header), sizeof(header)).gcount() != sizeof(header) ||
+        std::memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("Invalid trace file " + traceFilePath);
+    }
+    if (header.version != TRACE_VERSION) {
+        throw std::runtime_error((
+            boost::format("Unsupported trace version %d") % header.version)
+        .str());
+    }
+
+    vector<uint32_t> events(header.eventCount);
+    readFile.read(reinterpret_cast<char *>(events.data()), events.size() * sizeof(uint32_t));
+    if (readFile.gcount() != std::streamsize(events.size() * sizeof(uint32_t))) {
+        throw std::runtime_error("Truncated trace file " + traceFilePath);
+    }
+
+    return events;
+}
+
+/**
+ * @brief Replay the code along the recorded control flow, account
+ * instructions to functions and emit the optional outputs.
+ */
+class Replayer
+{
+public:
+    Replayer(const vector<VMInst> &codes, const vector<uint32_t> &events, const SymbolMap &symbolMap):
+        codes(codes), events(events), symbolMap(symbolMap) {}
+
+    void replay(bool isPartial, std::ostream *expandOut, std::ostream *timelineOut);
+
+    void printSummary(std::ostream &out) const;
+
+private:
+    const vector<VMInst> &codes;
+    const vector<uint32_t> &events;
+    const SymbolMap &symbolMap;
+
+    unordered_map<int, FuncAccount> accounts;
+    vector<Frame> frames;
+    long long time = 0; // instructions replayed
+    FuncAccount *currentAccount = nullptr; // of frames.back(), node addresses are stable
+    long long gapCount = 0;
+
+    std::ostream *timelineOut = nullptr;
+    bool firstTimelineEvent = true;
+
+    string getName(int entry) const {
+        return entry == UNKNOWN_ENTRY ? "?" : symbolMap.getFuncName(entry);
+    }
+
+    // function of a pc reached without a CALL event
+    int guessEntry(int pc) const {
+        const FuncSymbol *func = symbolMap.findFunc(pc);
+        return func == nullptr ? UNKNOWN_ENTRY : func->start;
+    }
+
+    void enter(int entry, int callPc);
+    void leave();
+    void writeTimelineEvent(int entry, const char *phase);
+
+    uint32_t expectEvent(size_t &eventIndex, int pc) const;
+};
+
+uint32_t Replayer::expectEvent(size_t &eventIndex, int pc) const
+{
+    const uint32_t event = events.at(eventIndex);
+    if (getTraceEventPc(event) != pc) {
+        throw std::runtime_error((
+            boost::format("Trace does not match the code: event %d at pc %d, replay at pc %d")
+            % eventIndex % getTraceEventPc(event) % pc)
+        .str());
+    }
+    eventIndex++;
+    return event;
+}
+
+void Replayer::writeTimelineEvent(int entry, const char *phase)
+{
+    if (timelineOut == nullptr) {
+        return;
+    }
+
+    // Chrome trace event format, one instruction is one microsecond
+    *timelineOut << (firstTimelineEvent ? "" : ",\n")
+                 << "{\"name\":\"" << getName(entry) << "\",\"ph\":\"" << phase
+                 << "\",\"ts\":" << time << ",\"pid\":1,\"tid\":1}";
+    firstTimelineEvent = false;
+}
+
+void Replayer::enter(int entry, int callPc)
+{
+    FuncAccount &account = accounts[entry];
+    account.calls++;
+    account.activeCount++;
+
+    frames.push_back({entry, callPc, time});
+    currentAccount = &account;
+    writeTimelineEvent(entry, "B");
+}
+
+void Replayer::leave()
+{
+    const Frame frame = frames.back();
+    frames.pop_back();
+
+    FuncAccount &account = accounts[frame.entry];
+    account.activeCount--;
+    if (account.activeCount == 0) {
+        account.totalInsts += time - frame.enterTime;
+    }
+    currentAccount = frames.empty() ? nullptr : &accounts[frames.back().entry];
+    writeTimelineEvent(frame.entry, "E");
+}
+
+void Replayer::replay(bool isPartial, std::ostream *expandOut, std::ostream *timelineOut)
+{
+    this->timelineOut = timelineOut;
+    if (timelineOut != nullptr) {
+        *timelineOut << "{\"traceEvents\":[\n";
+    }
+
+    size_t eventIndex = 0;
+    int pc = 0;
+    if (isPartial) {
+        pc = getTraceEventPc(events.front());
+    }
+    enter(isPartial ? guessEntry(pc) : 0, -1);
+
+    while (pc >= 0 && pc < codes.size()) {
+        const VMInst &inst = codes[pc];
+
+        // control flow without a recorded outcome: the trace ends here
+        const bool needsEvent = inst.opcode == InstructionType::JZ ||
+                                inst.opcode == InstructionType::CALL ||
+                                inst.opcode == InstructionType::RET;
+        if (needsEvent && eventIndex == events.size()) {
+            break;
+        }
+
+        time++;
+        currentAccount->selfInsts++;
+        if (expandOut != nullptr) {
+            *expandOut << pc << "\n";
+        }
+
+        switch (inst.opcode) {
+            case InstructionType::JMP:
+                pc += inst.operand;
+                break;
+
+            case InstructionType::JZ:
+                if (getTraceEventKind(expectEvent(eventIndex, pc)) == BRANCH_TAKEN) {
+                    pc += inst.operand;
+                } else {
+                    pc++;
+                }
+                break;
+
+            case InstructionType::CALL:
+                expectEvent(eventIndex, pc);
+                enter(pc + inst.operand, pc);
+                pc += inst.operand;
+                break;
+
+            case InstructionType::RET: {
+                expectEvent(eventIndex, pc);
+                const int callPc = frames.back().callPc;
+                leave();
+
+                if (callPc >= 0) {
+                    pc = callPc + 1;
+                } else {
+                    // returned from a frame entered before the ring window,
+                    // resume at the next recorded event
+                    if (eventIndex == events.size()) {
+                        pc = codes.size();
+                        break;
+                    }
+                    pc = getTraceEventPc(events[eventIndex]);
+                    gapCount++;
+                    if (frames.empty()) {
+                        enter(guessEntry(pc), -1);
+                    }
+                }
+                break;
+            }
+
+            default:
+                pc++;
+        }
+    }
+
+    while (frames.empty() == false) {
+        leave();
+    }
+
+    if (timelineOut != nullptr) {
+        *timelineOut << "\n]}\n";
+    }
+}
+
+void Replayer::printSummary(std::ostream &out) const
+{
+    vector<std::pair<int, FuncAccount>> rows(accounts.begin(), accounts.end());
+    std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) {
+        return a.second.selfInsts > b.second.selfInsts;
+    });
+
+    out << boost::format("%-24s %10s %14s %8s %14s\n") % "function" % "calls" % "self insts" % "self %" % "total insts";
+    for (const auto &[entry, account] : rows) {
+        out << boost::format("%-24s %10d %14d %7.2f%% %14d\n")
+            % getName(entry) % account.calls % account.selfInsts
+            % (time > 0 ? 100.0 * account.selfInsts / time : 0.0) % account.totalInsts;
+    }
+    out << "instructions replayed: " << time << "\n";
+    if (gapCount > 0) {
+        out << "unknown gaps (returns past the ring window): " << gapCount << "\n";
+    }
+}
+
+}
+
+bool TraceDecoder::readArgs(int argc, char **argv) {
+    namespace bpo = boost::program_options;
+
+    bpo::options_description desc(WELCOME_PROMPT);
+    desc.add_options()
+        ("help,h", "Show help message.")
+        ("trace,t", bpo::value<string>(&traceFilePath), "Decode trace file from <arg> path (recorded by cm --trace).")
+        ("asm,s", bpo::value<string>(&asmFilePath), "Assembly file the trace was recorded from.")
+        ("symbols", bpo::value<string>(&symbolFilePath), "Read function symbols from <arg> path. Default is <assembly file>.sym.")
+        ("expand", bpo::value<string>(&expandFilePath), "Output the reconstructed pc path, one pc per line, into <arg> path.")
+        ("timeline", bpo::value<string>(&timelineFilePath), "Output per-function timeline (Chrome trace event JSON) into <arg> path.");
+
+    bpo::variables_map var_map;
+    try {
+        bpo::store(bpo::parse_command_line(argc, argv, desc), var_map);
+
+        if (var_map.find("help") != var_map.end()) {
+            std::cout << desc << "\n";
+            return false;
+        }
+
+        bpo::notify(var_map);
+    } catch (std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return false;
+    } catch (...) {
+        std::cerr << "Unknown error during readArgs! \n";
+        return false;
+    }
+
+    if (traceFilePath.empty() || asmFilePath.empty()) {
+        std::cout << desc << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+void TraceDecoder::decode() const {
+    try {
+        const auto codes = AssemblyFileIO::readAsmFile(asmFilePath);
+        SymbolMap symbolMap(symbolFilePath.empty() ? SymbolMap::defaultPathOf(asmFilePath) : symbolFilePath);
+
+        TraceHeader header;
+        const auto events = readTraceFile(traceFilePath, header);
+        const bool isRing = (header.flags & TRACE_FLAG_RING) != 0;
+        // a ring that dropped nothing holds the whole run
+        const bool isPartial = isRing && header.droppedCount > 0;
+
+        std::ofstream expandFile, timelineFile;
+        if (expandFilePath.empty() == false) {
+            expandFile.open(expandFilePath);
+        }
+        if (timelineFilePath.empty() == false) {
+            timelineFile.open(timelineFilePath);
+        }
+
+        Replayer replayer(codes, events, symbolMap);
+        replayer.replay(isPartial,
+                        expandFilePath.empty() ? nullptr : &expandFile,
+                        timelineFilePath.empty() ? nullptr : &timelineFile);
+
+        std::cout << "events: " << header.eventCount;
+        if (isRing) {
+            std::cout << " (ring mode, " << header.droppedCount << " older events dropped)";
+        }
+        std::cout << "\n";
+        replayer.printSummary(std::cout);
+    } catch (std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+    }
+}
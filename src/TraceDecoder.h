@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+
+using std::string;
+
+class TraceDecoder
+{
+public:
+    TraceDecoder() {}
+
+    bool readArgs(int argc, char **argv);
+    void decode() const;
+
+private:
+    string traceFilePath;
+    string asmFilePath;
+    string symbolFilePath;
+    string expandFilePath;
+    string timelineFilePath;
+
+    const static string WELCOME_PROMPT;
+};
@@ -0,0 +1,90 @@
+#include "AsmStreamWriter.h"
+
+#include <charconv>
+#include <cstdio>
+#include <stdexcept>
+#include "InstructionType.h"
+
+AsmStreamWriter::AsmStreamWriter(const string &asmFilePath, const string &symbolFilePath):
+    asmFilePath(asmFilePath),
+    asmFile(asmFilePath, std::ios::binary)
+{
+    if (asmFile.is_open() == false) {
+        throw std::runtime_error("Cannot open assembly file " + asmFilePath);
+    }
+    if (symbolFilePath.empty() == false) {
+        symbolFile.open(symbolFilePath);
+        if (symbolFile.is_open() == false) {
+            throw std::runtime_error("Cannot open symbol file " + symbolFilePath);
+        }
+    }
+}
+
+vector<long long> AsmStreamWriter::write(const vector<Instruction> &insts, const vector<int> &patchable)
+{
+    vector<long long> positions;
+    positions.reserve(patchable.size());
+    auto nextPatchable = patchable.begin();
+
+    text.clear();
+    char operandBuf[16];
+    for (int i = 0; i < insts.size(); i++) {
+        const Instruction &inst = insts[i];
+
+        text += INST_TYPE2STR[static_cast<int>(inst.opcode)];
+        if (isUnaryInst(inst.opcode)) {
+            text += ' ';
+            if (nextPatchable != patchable.end() && *nextPatchable == i) {
+                positions.push_back(asmBytes + text.size());
+                formatPatchable(operandBuf, inst.operand);
+                text.append(operandBuf, PATCHABLE_WIDTH);
+                nextPatchable++;
+            } else {
+                const auto result = std::to_chars(operandBuf, operandBuf + sizeof(operandBuf), inst.operand);
+                text.append(operandBuf, result.ptr);
+            }
+        }
+        text += '\n';
+
+        if (symbolFile.is_open() && inst.lineNo != lastLineNo) {
+            lastLineNo = inst.lineNo;
+            symbolFile << "line " << instCount + i << " " << lastLineNo << "\n";
+        }
+    }
+
+    asmFile.write(text.data(), text.size());
+    asmBytes += text.size();
+    instCount += insts.size();
+    return positions;
+}
+
+void AsmStreamWriter::patchOperand(long long position, int operand)
+{
+    char operandBuf[16];
+    formatPatchable(operandBuf, operand);
+
+    asmFile.seekp(position);
+    asmFile.write(operandBuf, PATCHABLE_WIDTH);
+    asmFile.seekp(asmBytes);
+}
+
+void AsmStreamWriter::finish(const vector<FuncSymbol> &funcSymbols)
+{
+    if (symbolFile.is_open()) {
+        for (const auto &func : funcSymbols) {
+            symbolFile << "func " << func.start << " " << func.end << " " << func.name << "\n";
+        }
+        symbolFile.close();
+    }
+
+    asmFile.close();
+    if (asmFile.fail()) {
+        throw std::runtime_error("Cannot write assembly file " + asmFilePath);
+    }
+}
+
+// e.g. "00000000042", "-0000000042"
+void AsmStreamWriter::formatPatchable(char *buf, int operand)
+{
+    std::snprintf(buf, 16, "%0*d", PATCHABLE_WIDTH, operand);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Instruction.h"
+#include "SymbolMap.h"
+
+using std::string;
+using std::vector;
+
+/**
+ * @brief Writes an assembly file (and its symbol file) while the code
+ * is generated, a chunk of instructions at a time
+ *
+ * @details Same format as AssemblyFileIO, except that an operand still
+ * unknown when its chunk is written is zero-padded to a fixed width,
+ * e.g. `call -0000000042`, and overwritten in place once known.
+ * Symbol file: line records are written with their chunk, func records
+ * at last (SymbolMap doesn't need them first).
+ */
+class AsmStreamWriter
+{
+public:
+    // no symbol file if symbolFilePath is empty
+    AsmStreamWriter(const string &asmFilePath, const string &symbolFilePath);
+
+    /**
+     * @brief Append insts, numbered from size()
+     * @param patchable indexes in insts (ascending) of operands to patch
+     * @return file position of each patchable operand
+     */
+    vector<long long> write(const vector<Instruction> &insts, const vector<int> &patchable);
+
+    // overwrite the operand at position, returned by write()
+    void patchOperand(long long position, int operand);
+
+    // write func records and close both files
+    void finish(const vector<FuncSymbol> &funcSymbols);
+
+    // instructions written
+    int size() const {
+        return instCount;
+    }
+
+    long long bytes() const {
+        return asmBytes;
+    }
+
+private:
+    // "-2147483648"
+    static constexpr int PATCHABLE_WIDTH = 11;
+
+    string asmFilePath;
+    std::ofstream asmFile;
+    std::ofstream symbolFile;
+
+    int instCount = 0;
+    long long asmBytes = 0;
+    int lastLineNo = -1;
+
+    // text of the chunk being written
+    string text;
+
+    static void formatPatchable(char *buf, int operand);
+};
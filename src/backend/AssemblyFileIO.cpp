@@ -4,6 +4,7 @@
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
+#include <charconv>
 #include <boost/format.hpp>
 
 void AssemblyFileIO::throwInvalidInstErr(const string &token)
@@ -45,17 +46,43 @@ vector<VMInst> AssemblyFileIO::readAsmFile(const string &asmFilePath)
 // array of Attribute Instruction to C-Minus ASM
 void AssemblyFileIO::writeAsmFile(const string &asmFilePath, const vector<Instruction> &insts)
 {
-    std::ofstream writeFile(asmFilePath);
+    string text;
+    text.reserve(insts.size() * 8);
 
+    char operandBuf[16];
     for (const auto &inst : insts) {
-        const string &opcode = inst.opcodeStr;
-        if (NULLARY_INST_STR2TYPE.find(opcode) != NULLARY_INST_STR2TYPE.end()) {
-            writeFile << opcode << "\n";
-        } else if (UNARY_INST_STR2TYPE.find(opcode) != UNARY_INST_STR2TYPE.end()) {
-            const string &operand = inst.operandStr;
-            writeFile << opcode << " " << operand << "\n";
-        } else {
-            throwInvalidInstErr(opcode);
+        text += INST_TYPE2STR[static_cast<int>(inst.opcode)];
+        if (isUnaryInst(inst.opcode)) {
+            const auto result = std::to_chars(operandBuf, operandBuf + sizeof(operandBuf), inst.operand);
+            text += ' ';
+            text.append(operandBuf, result.ptr);
+        }
+        text += '\n';
+    }
+
+    std::ofstream writeFile(asmFilePath);
+    writeFile.write(text.data(), text.size());
+}
+
+/**
+ * @brief Write the symbol file of an assembly file
+ * @details Line records are run-length encoded: `line START LINENO`
+ * covers instructions from START up to the next line record.
+ */
+void AssemblyFileIO::writeSymbolFile(const string &symbolFilePath,
+                                     const vector<FuncSymbol> &funcSymbols, const vector<Instruction> &insts)
+{
+    std::ofstream writeFile(symbolFilePath);
+
+    for (const auto &func : funcSymbols) {
+        writeFile << "func " << func.start << " " << func.end << " " << func.name << "\n";
+    }
+
+    int lastLineNo = -1;
+    for (int i = 0; i < insts.size(); i++) {
+        if (insts.at(i).lineNo != lastLineNo) {
+            lastLineNo = insts.at(i).lineNo;
+            writeFile << "line " << i << " " << lastLineNo << "\n";
         }
     }
 }
@@ -3,6 +3,7 @@
 #include <vector>
 #include "VMInst.h"      // VM Instruction
 #include "Instruction.h" // Attribute Instruction
+#include "SymbolMap.h"
 
 using std::vector;
 
@@ -13,6 +14,10 @@ public:
 
     // Encoder
     static void writeAsmFile(const string &asmFilePath, const vector<Instruction> &insts);
+
+    // Function ranges and line table, read back by SymbolMap
+    static void writeSymbolFile(const string &symbolFilePath,
+                                const vector<FuncSymbol> &funcSymbols, const vector<Instruction> &insts);
 private:
     static void throwInvalidInstErr(const string &token);
 
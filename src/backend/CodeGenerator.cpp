@@ -1,26 +1,17 @@
 #include <iostream>
 #include <stdexcept>
+#include <algorithm>
+#include <deque>
 #include <boost/format.hpp>
 #include "CodeGenerator.h"
 #include "Compiler.h"
 
-inline void printSymbolTable(const SymbolTable &symbolTable) {
-    for (const auto &[k, v] : symbolTable) {
-        // std::cout << k << ": ";
-        for (const auto &[k1, v1] : v) {
-            string printStr = (boost::format("  %s: {%d, %s, %d}\n") 
-                % k1 % v1.variableIndex 
-                % v1.variableType % v1.varSize).str();
-            // std::cout << printStr;
-        }
-        // std::cout << "\n";
-    }
-}
-
-// a += b
-inline void appendInstructions(vector<Instruction> &a, const vector<Instruction> &b) {
-    a.insert(a.end(), b.begin(), b.end());
-}
+CodeGenerator::CodeGenerator(AST *root, const SymbolTable &symbolTable):
+    root(root),
+    symbolTable(symbolTable),
+    inputId(Interner::global().intern("input")),
+    outputId(Interner::global().intern("output")),
+    mainId(Interner::global().intern(MAIN_NAME)) {}
 
 void CodeGenerator::throwIdNotFoundErr(const string &id) 
 {
@@ -29,87 +20,251 @@ void CodeGenerator::throwIdNotFoundErr(const string &id)
     .str());
 }
 
+int CodeGenerator::emit(InstCategory category, InstructionType opcode, int operand)
+{
+    insts.emplace_back(opcode, operand);
+    insts.back().lineNo = currentLineNo;
+    insts.back().category = category;
+    return insts.size() - 1;
+}
+
+void CodeGenerator::patchJumpHere(int jumpOffset)
+{
+    insts.at(jumpOffset).operand = insts.size() - jumpOffset;
+}
+
+/**
+ * @return the line to restore once the node is generated
+ * @details An inner node with a known line overrides its parents.
+ */
+int CodeGenerator::enterLine(int lineNo)
+{
+    const int outerLineNo = currentLineNo;
+    if (lineNo != 0) {
+        currentLineNo = lineNo;
+    }
+    return outerLineNo;
+}
+
 /**
  * @brief entry of CodeGenerator
  * @return vector<Instruction> all instructions generated
+ * @details Layout: global variables and the call to main(), then
+ * functions in source order, main() at last.
  */
-vector<Instruction> CodeGenerator::generate() const
+vector<Instruction> CodeGenerator::generate()
 {
-    const InstructionMap instMap = createInstMap();
-    // std::cout << "After entry\n";
+    reset();
+
+    const AST *mainDecl = findMain();
+    generatePrelude(mainDecl->getChildren().at(1)->getBinding().index);
+
+    for (const AST *const decl : root->getChildren()) {
+        if (decl->getTokenType() == TokenType::FUNC_DECL && decl != mainDecl) {
+            generateFunction(decl);
+        }
+    }
 
-    unordered_map<string, int> funcCallMap;
-    
-    vector<Instruction> insts = mergeInstMap(instMap, funcCallMap);
+    // append main code at last
+    generateFunction(mainDecl);
 
-    translateCall(insts, funcCallMap);
+    link();
 
-    return insts;
+    return std::move(insts);
+}
+
+/**
+ * @brief Same as generate(), functions generated on pool
+ * @details Functions are split in batches of consecutive ones (in the
+ * order of generate()), each generated into its own buffer by a
+ * CodeGenerator of its own. They only read the AST and the symbol table.
+ * Buffers are appended in order and calls linked as by generate(), so
+ * the output doesn't depend on the threads.
+ */
+vector<Instruction> CodeGenerator::generate(ThreadPool &pool)
+{
+    reset();
+
+    const AST *mainDecl = findMain();
+    generatePrelude(mainDecl->getChildren().at(1)->getBinding().index);
+
+    // main() at last
+    vector<const AST *> funcDecls;
+    for (const AST *const decl : root->getChildren()) {
+        if (decl->getTokenType() == TokenType::FUNC_DECL && decl != mainDecl) {
+            funcDecls.push_back(decl);
+        }
+    }
+    funcDecls.push_back(mainDecl);
+
+    const size_t batchCount = std::min<size_t>(funcDecls.size(), pool.size() * 4);
+    std::deque<CodeGenerator> batches;
+    for (size_t b = 0; b < batchCount; b++) {
+        batches.emplace_back(nullptr, symbolTable);
+        batches.back().reset();
+    }
+
+    pool.parallelFor(batchCount, [&](size_t b) {
+        const size_t first = funcDecls.size() * b / batchCount;
+        const size_t last = funcDecls.size() * (b + 1) / batchCount;
+        for (size_t i = first; i < last; i++) {
+            batches[b].generateFunction(funcDecls[i]);
+        }
+    });
+
+    size_t instCount = insts.size();
+    for (const CodeGenerator &batch : batches) {
+        instCount += batch.insts.size();
+    }
+    insts.reserve(instCount);
+    for (CodeGenerator &batch : batches) {
+        append(batch);
+        vector<Instruction>().swap(batch.insts);
+    }
+
+    link();
+
+    return std::move(insts);
+}
+
+// FuncDecl -> Type id '(' Params ')' CompoundStmt
+const AST *CodeGenerator::findMain() const
+{
+    const AST *mainDecl = nullptr;
+    for (const AST *const decl : root->getChildren()) {
+        if (decl->getTokenType() == TokenType::FUNC_DECL &&
+            decl->getChildren().at(1)->getTokenId() == mainId) {
+            mainDecl = decl;
+        }
+    }
+    if (mainDecl == nullptr) {
+        throwIdNotFoundErr(MAIN_NAME);
+    }
+    return mainDecl;
+}
+
+void CodeGenerator::append(const CodeGenerator &part)
+{
+    const int base = baseOffset + insts.size();
+
+    insts.insert(insts.end(), part.insts.begin(), part.insts.end());
+    for (const auto &[offset, scope] : part.callRelocations) {
+        callRelocations.push_back({base + offset, scope});
+    }
+    for (int scope = 0; scope < part.funcOffsets.size(); scope++) {
+        if (part.funcOffsets[scope] != -1) {
+            funcOffsets.at(scope) = base + part.funcOffsets[scope];
+        }
+    }
+    for (const FuncSymbol &func : part.funcSymbols) {
+        funcSymbols.emplace_back(base + func.start, base + func.end, func.name);
+    }
+}
+
+void CodeGenerator::reset()
+{
+    insts.clear();
+    baseOffset = 0;
+    callRelocations.clear();
+    writtenCalls.clear();
+    funcOffsets.assign(symbolTable.size(), -1);
+    funcSymbols.clear();
+    currentLineNo = 0;
+}
+
+/**
+ * @brief Generate the code before main(), the $global function
+ * @details Starts a new output, must be generated first.
+ */
+void CodeGenerator::generatePrelude(int mainScope)
+{
+    reset();
+    generateBeforeMain(mainScope);
+    funcSymbols.emplace_back(0, insts.size(), GLOBAL_SCOPE_NAME);
+}
+
+/**
+ * @brief Start a new output by a jump to the prelude, for a prelude
+ * generated once all globals are declared, by generateLatePrelude()
+ * @details The jump is linked as a call to the $global scope.
+ */
+void CodeGenerator::generateEntryJump()
+{
+    reset();
+    callRelocations.push_back({baseOffset + emit(InstCategory::GLOBAL_INIT, InstructionType::JMP), 0});
+    funcSymbols.emplace_back(0, insts.size(), GLOBAL_SCOPE_NAME);
+}
+
+// generatePrelude() after the functions, right before main()
+void CodeGenerator::generateLatePrelude(int mainScope)
+{
+    const int start = baseOffset + insts.size();
+    funcOffsets.at(0) = start;
+    generateBeforeMain(mainScope);
+    funcSymbols.emplace_back(start, baseOffset + insts.size(), GLOBAL_SCOPE_NAME);
 }
 
 /**
  * @brief Generate load-literal (constant) instruction
- * @return vector<Instruction> contains only a LDC instruction
+ * @details a LDC instruction
  */
-vector<Instruction> CodeGenerator::generateLiteral(const AST *root, const string &scopeName) const
+void CodeGenerator::generateLiteral(const AST *root)
 {
-    return { Instruction("ldc", root->getTokenStr()) };
+    emit(InstCategory::EXPR, InstructionType::LDC, std::stoi(root->getTokenStr()));
 }
 
 /**
  * @brief Get all instructions in a compound statement
- * @return Array of instructions
  * @details LocalVariableDecl is not generated. Pushing them 
  * into the stack is done during a function call.
  * @EBNF CompoundStmt -> '{' LocalVariableDecl StmtList '}'
  */
-vector<Instruction> CodeGenerator::generateCompoundStmt(const AST *root, const string &scopeName) const
+void CodeGenerator::generateCompoundStmt(const AST *root)
 {
-    return generateStmtList(root->getChildren().at(1), scopeName);
+    generateStmtList(root->getChildren().at(1));
 }
 
 /**
  * @brief Get all instructions in a statement list
- * @return Array of instructions
  * @EBNF StmtList -> { Stmt }
  */
-vector<Instruction> CodeGenerator::generateStmtList(const AST *root, const string &scopeName) const
+void CodeGenerator::generateStmtList(const AST *root)
 {
-    vector<Instruction> insts;
-
     for (const AST* const stmt : root->getChildren()) {
         // std::cout << "Before generate Stmt\n";
-        const vector<Instruction> stmtInsts = generateStmt(stmt, scopeName);
-        appendInstructions(insts, stmtInsts);
+        generateStmt(stmt);
     }
-
-    return insts;
 }
 
 /**
  * @brief Reduce Stmt
  * @EBNF Stmt -> ExprStmt | CompoundStmt | IfStmt | WhileStmt | ReturnStmt
  */
-vector<Instruction> CodeGenerator::generateStmt(const AST *root, const string &scopeName) const
+void CodeGenerator::generateStmt(const AST *root)
 {
     if (root == nullptr) {
-        return {};
+        return;
     }
 
+    const int outerLineNo = enterLine(root->getLineNo());
     switch (root->getTokenType()) {
-        case TokenType::EXPR:
-            return generateExpr(root, scopeName);
         case TokenType::COMPOUND_STMT:
-            return generateCompoundStmt(root, scopeName);
+            generateCompoundStmt(root);
+            break;
         case TokenType::IF_STMT:
-            return generateIfStmt(root, scopeName);
+            generateIfStmt(root);
+            break;
         case TokenType::WHILE_STMT:
-            return generateWhileStmt(root, scopeName);
+            generateWhileStmt(root);
+            break;
         case TokenType::RETURN_STMT:
-            return generateReturnStmt(root, scopeName);
+            generateReturnStmt(root);
+            break;
         default:
-            throw std::runtime_error("Invalid token while generating Stmt");
+            // ExprStmt
+            generateExpr(root);
     }
+    currentLineNo = outerLineNo;
 }
 
 /**
@@ -132,38 +287,27 @@ vector<Instruction> CodeGenerator::generateStmt(const AST *root, const string &s
  * ELSE:
  *     ... # elseInstSize
  * END:
+ *
+ * jz / jmp are patched when ELSE / END is reached.
  */
-vector<Instruction> CodeGenerator::generateIfStmt(const AST *root, const string &scopeName) const
+void CodeGenerator::generateIfStmt(const AST *root)
 {
     const auto &children = root->getChildren();
-    auto insts = generateExpr(children.at(0), scopeName);
-    auto ifInsts = generateStmt(children.at(1), scopeName);
+    generateExpr(children.at(0));
+    const int jzOffset = emit(InstCategory::BRANCH, InstructionType::JZ);
+    generateStmt(children.at(1));
 
     if (children.size() == 2) {
         // if statement
-
-        // +1 considers the JZ inst added.
-        const int jzOffset = ifInsts.size() + 1;
-        insts.emplace_back("jz", std::to_string(jzOffset));
-        appendInstructions(insts, ifInsts);
+        patchJumpHere(jzOffset);
     } else {
         // if-else statement
-        // std::cout << "?: ";
-        // std::cout << children.size() << " " << children.at(2)->getTokenStr() << "\n";
-        auto elseInsts = generateStmt(children.at(2), scopeName);
-        // std::cout << "!\n";
-
-        const int jmpOffset = elseInsts.size() + 1;
-        ifInsts.emplace_back("jmp", std::to_string(jmpOffset));
+        const int jmpOffset = emit(InstCategory::BRANCH, InstructionType::JMP);
+        patchJumpHere(jzOffset);
 
-        const int jzOffset = ifInsts.size() + 1;
-        insts.emplace_back("jz", std::to_string(jzOffset));
-
-        appendInstructions(insts, ifInsts);
-        appendInstructions(insts, elseInsts);
+        generateStmt(children.at(2));
+        patchJumpHere(jmpOffset);
     }
-
-    return insts;
 }
 
 /**
@@ -177,56 +321,64 @@ vector<Instruction> CodeGenerator::generateIfStmt(const AST *root, const string
  *     jmp START
  * END:
  */
-vector<Instruction> CodeGenerator::generateWhileStmt(const AST *root, const string &scopeName) const 
+void CodeGenerator::generateWhileStmt(const AST *root)
 {
     const auto &children = root->getChildren();
-    auto insts = generateExpr(children.at(0), scopeName);
-    auto stmtInsts = generateStmt(children.at(1), scopeName);
-
-    const int jzOffset = stmtInsts.size() + 2;
-    insts.emplace_back("jz", std::to_string(jzOffset));
+    const int start = insts.size();
+    generateExpr(children.at(0));
+    const int jzOffset = emit(InstCategory::LOOP, InstructionType::JZ);
 
-    appendInstructions(insts, stmtInsts);
+    generateStmt(children.at(1));
 
     // negative (GOTO)
-    const int jmpOffset = -insts.size();
-    insts.emplace_back("jmp", std::to_string(jmpOffset));
+    const int jmpOffset = start - static_cast<int>(insts.size());
+    emit(InstCategory::LOOP, InstructionType::JMP, jmpOffset);
 
-    return insts;
+    patchJumpHere(jzOffset);
 }
 
 /**
  * @brief Return value is passed by register (acc)
  * @EBNF ReturnStmt -> return [ Expr ] ';'
  */
-vector<Instruction> CodeGenerator::generateReturnStmt(const AST *root, const string &scopeName) const 
+void CodeGenerator::generateReturnStmt(const AST *root)
 {
     if (root == nullptr || root->getChildren().empty()) {
-        return {};
+        return;
     }
 
-    return generateExpr(root->getChildren().at(0), scopeName);
+    generateExpr(root->getChildren().at(0));
 }
 
 /**
  * @EBNF Expr -> SimpleExpr | Variable '=' Expr
+ * @EBNF Factor -> '(' Expr ')' | Variable | Call | literal
+ * @details Any expression node, see the expression AST in Parser.h
  */
-vector<Instruction> CodeGenerator::generateExpr(const AST *root, const string &scopeName) const 
+void CodeGenerator::generateExpr(const AST *root)
 {
-    // std::cout << "-> Return Expr\n";
-    const auto &children = root->getChildren();
-    if (children.size() == 1) {
-        // SimpleExpr
-        return generateSimpleExpr(children.at(0), scopeName);
-    }
+    const int outerLineNo = enterLine(root->getLineNo());
 
-    // AssignmentExpr
-    // Note: calculate Expr first, then Variable
-    auto insts = generateExpr(children.at(1), scopeName);
-    auto assignmentInsts = generateAssign(children.at(0), scopeName);
-    appendInstructions(insts, assignmentInsts);
+    switch (root->getTokenType()) {
+        case TokenType::ASSIGN:
+            // Note: calculate Expr first, then Variable
+            generateExpr(root->getChildren().at(1));
+            generateAssign(root->getChildren().at(0));
+            break;
+        case TokenType::VARIABLE:
+            generateLoadVariable(root);
+            break;
+        case TokenType::CALL:
+            generateCall(root);
+            break;
+        case TokenType::LITERAL:
+            generateLiteral(root);
+            break;
+        default:
+            generateBinaryExpr(root);
+    }
 
-    return insts;
+    currentLineNo = outerLineNo;
 }
 
 /**
@@ -248,54 +400,45 @@ vector<Instruction> CodeGenerator::generateExpr(const AST *root, const string &s
  *     pop   # reserve top
  *     absld # index array element
  */
-vector<Instruction> CodeGenerator::generateLoadVariable(const AST *root, const string &scopeName) const 
+void CodeGenerator::generateLoadVariable(const AST *root)
 {
-    vector<Instruction> insts;
     const auto &children = root->getChildren();
-    const auto &scopeSymbolTable = symbolTable.at(scopeName);
-    const auto &globalSymbolTable = symbolTable.at(GLOBAL_SCOPE_NAME);
-
-    const string &id = children.at(0)->getTokenStr();
-    if (scopeSymbolTable.find(id) != scopeSymbolTable.end()) {
-        // find id in local symbol table
+    const Binding &binding = children.at(0)->getBinding();
 
+    if (binding.kind == Binding::LOCAL) {
         // load index then load local AR
-        insts.emplace_back("ldc", std::to_string(scopeSymbolTable.at(id).variableIndex));
-        insts.emplace_back("ld");
-    } else if (globalSymbolTable.find(id) != globalSymbolTable.end()) {
-        // find id in global symbol table
-
-        insts.emplace_back("ldc", std::to_string(globalSymbolTable.at(id).variableIndex));
-        insts.emplace_back("absld");  // FIX BUG!!
+        emit(InstCategory::LOAD, InstructionType::LDC, binding.index);
+        emit(InstCategory::LOAD, InstructionType::LD);
+    } else if (binding.kind == Binding::GLOBAL) {
+        emit(InstCategory::LOAD, InstructionType::LDC, binding.index);
+        emit(InstCategory::LOAD, InstructionType::ABSLD);  // FIX BUG!!
     } else {
-        throwIdNotFoundErr(id);
+        throwIdNotFoundErr(children.at(0)->getTokenStr());
     }
 
     // array element, do more
     if (children.size() == 2) {
-        auto exprInsts = generateExpr(children.at(1), scopeName);
+        emit(InstCategory::ARRAY_INDEX, InstructionType::PUSH);
 
-        insts.emplace_back("push");
+        generateExpr(children.at(1));
 
-        appendInstructions(insts, exprInsts);
-
-        insts.emplace_back("add");
-        insts.emplace_back("pop");
-        insts.emplace_back("absld");
+        emit(InstCategory::ARRAY_INDEX, InstructionType::ADD);
+        emit(InstCategory::ARRAY_INDEX, InstructionType::POP);
+        emit(InstCategory::ARRAY_INDEX, InstructionType::ABSLD);
     }
-
-    return insts;
 }
 
 /**
  * @EBNF SimpleExpr -> AddExpr [ RelationOp AddExpr ]
- * 
- * @details Expression evaluation. 
+ * @EBNF AddExpr -> Term { AddOp Term }
+ * @EBNF Term -> Factor { MulOp Factor }
+ *
+ * @details Expression evaluation.
  * Postorder traverse the binary tree.
  *      <
  *    /   \
  *   3     4
- * 
+ *
  * START:
  *     ...   # acc = lhs
  *     push  # top = lhs (store top)
@@ -303,277 +446,158 @@ vector<Instruction> CodeGenerator::generateLoadVariable(const AST *root, const s
  *     op    # acc = top op acc = lhs op rhs
  *     pop   # reserve top
  */
-vector<Instruction> CodeGenerator::generateSimpleExpr(const AST *root, const string &scopeName) const
+void CodeGenerator::generateBinaryExpr(const AST *root)
 {
     const auto &children = root->getChildren();
-    if (children.size() == 1) {
-        // std::cout << "-> Return Expr\n";
-        return generateAddExpr(children.at(0), scopeName);
-    }
+    const InstructionType op = getBinaryOp(root);
 
-    auto insts = generateAddExpr(children.at(0), scopeName);
-    auto op = generateRelationOp(children.at(1), scopeName);
-    auto rhs = generateAddExpr(children.at(2), scopeName);
-
-    insts.emplace_back("push");
-    appendInstructions(insts, rhs);
-    appendInstructions(insts, op);
-    insts.emplace_back("pop");
-
-    return insts;
+    generateExpr(children.at(0));
+    emit(InstCategory::EXPR, InstructionType::PUSH);
+    generateExpr(children.at(1));
+    emit(InstCategory::EXPR, op);
+    emit(InstCategory::EXPR, InstructionType::POP);
 }
 
 /**
  * @EBNF RelationOp -> < | <= | > | >= | == | !=
+ * @EBNF AddOp -> + | -
+ * @EBNF MulOp -> * | /
  */
-vector<Instruction> CodeGenerator::generateRelationOp(const AST *root, const string &) const 
+InstructionType CodeGenerator::getBinaryOp(const AST *root)
 {
     switch (root->getTokenType()) {
         case TokenType::LESS:
-            return { Instruction("lt") };
+            return InstructionType::LT;
         case TokenType::LESS_EQUAL:
-            return { Instruction("lte") };
+            return InstructionType::LTE;
         case TokenType::GREATER:
-            return { Instruction("gt") };
+            return InstructionType::GT;
         case TokenType::GREATER_EQUAL:
-            return { Instruction("gte") };
+            return InstructionType::GTE;
         case TokenType::EQUAL:
-            return { Instruction("eq") };
+            return InstructionType::EQ;
         case TokenType::NOT_EQUAL:
-            return { Instruction("neq") };
+            return InstructionType::NEQ;
+        case TokenType::PLUS:
+            return InstructionType::ADD;
+        case TokenType::MINUS:
+            return InstructionType::SUB;
+        case TokenType::MULTIPLY:
+            return InstructionType::MUL;
+        case TokenType::DIVIDE:
+            return InstructionType::DIV;
         default:
-            throw std::runtime_error("Invalid token while generating RelationOp");
+            throw std::runtime_error("Invalid token while generating Expr");
     }
 }
 
 /**
- * @EBNF AddExpr -> Term { AddOp Term }
- * @brief postorder eval, left associative
+ * @EBNF Call -> id '(' [ ArgList ] ')'
  */
-vector<Instruction> CodeGenerator::generateAddExpr(const AST *root, const string &scopeName) const
+void CodeGenerator::generateCall(const AST *root)
 {
     const auto &children = root->getChildren();
+    const AST *idNode = children.at(0);
 
-    // // Debug Only
-    // // std::cout << "-> DEBUG\n";
-    // for (const auto &child : children) {
-    //     // std::cout << child->getLineNo() << " ";
-    // }
-    // // std::cout << children.size() << ", END DEBUG\n";
-
-    auto insts = generateTerm(children.at(0), scopeName);
-
-    for (int i = 1; i < children.size(); i += 2) {
-        auto op = generateAddOp(children.at(i), scopeName);
-        auto rhs = generateTerm(children.at(i + 1), scopeName);
-
-        insts.emplace_back("push");
-        appendInstructions(insts, rhs);
-        appendInstructions(insts, op);
-        insts.emplace_back("pop");
+    // natives
+    if (idNode->getTokenId() == inputId) {
+        emit(InstCategory::NATIVE_IO, InstructionType::IN);
+        return;
+    } else if (idNode->getTokenId() == outputId) {
+        generateExpr(children.at(1)->getChildren().at(0));
+        emit(InstCategory::NATIVE_IO, InstructionType::OUT);
+        return;
     }
 
-    return insts;
-}
-
-/**
- * @EBNF AddOp -> + | -
- */
-vector<Instruction> CodeGenerator::generateAddOp(const AST *root, const string &scopeName) const 
-{
-    if (root->getTokenType() == TokenType::PLUS) {
-        return { Instruction("add") };
-    } else if (root->getTokenType() == TokenType::MINUS) {
-        return { Instruction("sub") };
-    } else {
-        throw std::runtime_error("Invalid token while generating AddOp");
+    const Binding &binding = idNode->getBinding();
+    if (binding.kind != Binding::FUNCTION) {
+        throwIdNotFoundErr(idNode->getTokenStr());
     }
-}
-
-/**
- * @EBNF Term -> Factor { MulOp Factor }
- */
-vector<Instruction> CodeGenerator::generateTerm(const AST *root, const string &scopeName) const
-{
-    const auto &children = root->getChildren();
-
-        // Debug Only
-    // // std::cout << "-> DEBUG\n";
-    // for (const auto &child : children) {
-    //     // std::cout << child->getLineNo() << " ";
-    // }
-    // // std::cout << children.size() << ", END DEBUG\n";
+    const Scope &scope = symbolTable.at(binding.index);
 
-    auto insts = generateFactor(children.at(0), scopeName);
+    /* 1. caller push paramters and local variables for callee */
 
-    for (int i = 1; i < children.size(); i += 2) {
-        auto op = generateMulOp(children.at(i), scopeName);
-        auto rhs = generateFactor(children.at(i + 1), scopeName);
+    int paramSize = 0;
+    const bool hasParam = children.size() >= 2;
+    if (hasParam) {
+        // has param(s)
+        paramSize = children.at(1)->getChildren().size();
+    }
+    generateFrame(scope, paramSize);
 
-        insts.emplace_back("push");
-        appendInstructions(insts, rhs);
-        appendInstructions(insts, op);
-        insts.emplace_back("pop");
+    // push params
+    // if a param is an array, it's passed by pointer.
+    if (hasParam) {
+        generateArgList(children.at(1));
     }
 
-    return insts;
-}
+    /* 2. Caller store context and move PC */
 
-/**
- * @EBNF MulOp -> * | /
- */
-vector<Instruction> CodeGenerator::generateMulOp(const AST *root, const string &scopeName) const 
-{
-    if (root->getTokenType() == TokenType::MULTIPLY) {
-        return { Instruction("mul") };
-    } else if (root->getTokenType() == TokenType::DIVIDE) {
-        return { Instruction("div") };
-    } else {
-        throw std::runtime_error("Invalid token while generating MulOp");
-    }    
-}
+    // Linker will translate the scope to an offset.
+    callRelocations.push_back({baseOffset + emit(InstCategory::CALL_SETUP, InstructionType::CALL), binding.index});
 
-/**
- * @EBNF Factor -> '(' Expr ')' | Variable | Call | literal
- */
-vector<Instruction> CodeGenerator::generateFactor(const AST *root, const string &scopeName) const 
-{
-    if (root == nullptr) {
-        return {};
-    }
-    // std::cout << "-> Trace\n";
+    /* 3. Caller recollects stack frame used by callee */
 
-    switch (root->getTokenType()) {
-        case TokenType::EXPR:
-            return generateExpr(root, scopeName);
-        case TokenType::VARIABLE:
-            return generateLoadVariable(root, scopeName);
-        case TokenType::CALL:
-            return generateCall(root, scopeName);
-        case TokenType::LITERAL:
-            return generateLiteral(root, scopeName);
-        default:
-            throw std::runtime_error("Invalid token while generating Factor");
+    for (const int varSize : scope.frame) {
+        emit(InstCategory::CALL_TEARDOWN, InstructionType::POP);
+        int repeatCnt = varSize;
+        while (repeatCnt--) {
+            emit(InstCategory::CALL_TEARDOWN, InstructionType::POP);
+        }
     }
 }
 
 /**
- * @EBNF Call -> id '(' [ ArgList ] ')'
+ * @brief Push the local variables of a callee, the last declared first
+ * @details Stack: LocalVariable n, n - 1, ... 0, Parameter m, m - 1, 0
+ * (parameters are pushed by the caller afterwards).
  */
-vector<Instruction> CodeGenerator::generateCall(const AST *root, const string &scopeName) const 
+void CodeGenerator::generateFrame(const Scope &scope, int paramSize)
 {
-    const auto &children = root->getChildren();
-    const string &id = children.at(0)->getTokenStr();
-
-    // natives
-    if (id == "input") {
-        return { Instruction("in") };
-    } else if (id == "output") {
-        auto insts = generateExpr(children.at(1)->getChildren().at(0), scopeName);
+    const auto &frame = scope.frame;
+    const int n = frame.size();
 
-        insts.emplace_back("out");
-        return insts;
-    }
-
-    vector<Instruction> insts;
-
-    if (symbolTable.find(id) == symbolTable.end()) {
-        throwIdNotFoundErr(id);
-    }
-    const auto &scopeSymbolTable = symbolTable.at(id);
-    const int n = scopeSymbolTable.size();
-
-    /* 1. caller push paramters and local variables for callee */
-    // std::cout << "Call 1\n";
-
-    // LocalVariable n, n - 1, ... 0, Parameter m, m - 1, 0
-    vector<pair<string, VariableAttribute>> stackSeq(n);
-    for (const auto &[k, v] : scopeSymbolTable) {
-        stackSeq.at(n - v.variableIndex - 1) = {k, v};
-    }
-
-    int paramSize = 0;
-    const bool hasParam = children.size() >= 2;
-    if (hasParam) {
-        // has param(s)
-        paramSize = children.at(1)->getChildren().size();
-    }
     const int localVariableSize = n - paramSize;
-    // std::cout << localVariableSize << "\n";
     if (localVariableSize < 0)
     {
         throw std::runtime_error((
             boost::format("param size %d too large!") % localVariableSize)
         .str());
     }
-    // std::cout << "before push local variables\n";
 
     // push local variables
     for (int i = 0; i < localVariableSize; i++) {
-        const int varSize = stackSeq.at(i).second.varSize;
+        const int varSize = frame.at(n - i - 1);
         if (varSize == 0) {
             // is single
-            insts.emplace_back("push");
+            emit(InstCategory::CALL_SETUP, InstructionType::PUSH);
         } else {
             // is array
             int repeatCnt = varSize;
             while (repeatCnt--) {
                 // give array space
-                insts.emplace_back("push");
+                emit(InstCategory::CALL_SETUP, InstructionType::PUSH);
             }
 
             // calculate the start pointer of array
-            insts.emplace_back("addr", std::to_string(varSize));
+            emit(InstCategory::CALL_SETUP, InstructionType::ADDR, varSize);
             // then push it into the stack (write it by acc)
-            insts.emplace_back("push");
+            emit(InstCategory::CALL_SETUP, InstructionType::PUSH);
         }
     }
-    // std::cout << "after push local variables\n";
-
-    // push params
-    // if a param is an array, it's passed by pointer.
-    if (hasParam) {
-        auto argListInsts = generateArgList(children.at(1), scopeName);
-        appendInstructions(insts, argListInsts);
-    }
-
-    /* 2. Caller store context and move PC */
-
-    // Linker will translate the id to an offset.
-    insts.emplace_back("call", id);
-
-    /* 3. Caller recollects stack frame used by callee */
-
-    for (const auto &[k, v] : scopeSymbolTable) {
-        insts.emplace_back("pop");
-        int repeatCnt = v.varSize;
-        while (repeatCnt--) {
-            insts.emplace_back("pop");
-        }
-    }
-    // std::cout << "All over\n";
-
-    return insts;
 }
 
-// vector<Instruction> CodeGenerator::generateNativeCall(const AST *root, const string &scopeName) const {}
-
 /**
  * @EBNF ArgList -> Expr { ',' Expr }
  */
-vector<Instruction> CodeGenerator::generateArgList(const AST *root, const string &scopeName) const 
+void CodeGenerator::generateArgList(const AST *root)
 {
     const auto &children = root->getChildren();
-    vector<Instruction> insts;
 
     for (int i = children.size() - 1; i >= 0; i--) {
-        auto exprInsts = generateExpr(children.at(i), scopeName);
-
-        appendInstructions(insts, exprInsts);
-        insts.emplace_back("push");
+        generateExpr(children.at(i));
+        emit(InstCategory::CALL_SETUP, InstructionType::PUSH);
     }
-
-    return insts;
 }
 
 /**
@@ -583,226 +607,176 @@ vector<Instruction> CodeGenerator::generateArgList(const AST *root, const string
  * before calling this function, the assigned value is stored
  * in acc register.
  */
-vector<Instruction> CodeGenerator::generateAssign(const AST *root, const string &scopeName) const 
+void CodeGenerator::generateAssign(const AST *root)
 {
     const auto &children = root->getChildren();
-    vector<Instruction> insts;
 
-    insts.emplace_back("push"); // store top = acc
+    emit(InstCategory::ASSIGN, InstructionType::PUSH); // store top = acc
 
-    const auto &scopeSymbolTable = symbolTable.at(scopeName);
-    const auto &globalSymbolTable = symbolTable.at(GLOBAL_SCOPE_NAME);
-    const string &id = children.at(0)->getTokenStr();
+    const Binding &binding = children.at(0)->getBinding();
 
-    if (scopeSymbolTable.find(id) != scopeSymbolTable.end()) {
-        // find id in local symbol table
-        insts.emplace_back("ldc", std::to_string(scopeSymbolTable.at(id).variableIndex));
+    if (binding.kind == Binding::LOCAL) {
+        emit(InstCategory::ASSIGN, InstructionType::LDC, binding.index);
 
         if (children.size() == 1) {
             // single
-            insts.emplace_back("st");
+            emit(InstCategory::ASSIGN, InstructionType::ST);
         } else {
             // array
-            auto exprInsts = generateExpr(children.at(1), scopeName);
-
-            insts.emplace_back("ld");  // acc = &array
-            insts.emplace_back("push"); // top = &array
+            emit(InstCategory::ARRAY_INDEX, InstructionType::LD);  // acc = &array
+            emit(InstCategory::ARRAY_INDEX, InstructionType::PUSH); // top = &array
 
-            appendInstructions(insts, exprInsts); // acc = offset
+            generateExpr(children.at(1)); // acc = offset
 
-            insts.emplace_back("add");  // acc = &(array + offset)
-            insts.emplace_back("pop");  // reserve top
-            insts.emplace_back("absst");
+            emit(InstCategory::ARRAY_INDEX, InstructionType::ADD);  // acc = &(array + offset)
+            emit(InstCategory::ARRAY_INDEX, InstructionType::POP);  // reserve top
+            emit(InstCategory::ASSIGN, InstructionType::ABSST);
         }
-    } else if (globalSymbolTable.find(id) != globalSymbolTable.end()) {
-        insts.emplace_back("ldc", std::to_string(globalSymbolTable.at(id).variableIndex));
+    } else if (binding.kind == Binding::GLOBAL) {
+        emit(InstCategory::ASSIGN, InstructionType::LDC, binding.index);
 
         if (children.size() == 1) {
-            insts.emplace_back("absst");
+            emit(InstCategory::ASSIGN, InstructionType::ABSST);
         } else {
-            auto exprInsts = generateExpr(children.at(1), scopeName);
-            insts.emplace_back("absld");
-            insts.emplace_back("push");
+            emit(InstCategory::ARRAY_INDEX, InstructionType::ABSLD);
+            emit(InstCategory::ARRAY_INDEX, InstructionType::PUSH);
 
-            appendInstructions(insts, exprInsts); // acc = offset
+            generateExpr(children.at(1)); // acc = offset
 
-            insts.emplace_back("add");  // acc = &(array + offset)
-            insts.emplace_back("pop");  // reserve top
-            insts.emplace_back("absst");
+            emit(InstCategory::ARRAY_INDEX, InstructionType::ADD);  // acc = &(array + offset)
+            emit(InstCategory::ARRAY_INDEX, InstructionType::POP);  // reserve top
+            emit(InstCategory::ASSIGN, InstructionType::ABSST);
         }
     } else {
-        throwIdNotFoundErr(id);
+        throwIdNotFoundErr(children.at(0)->getTokenStr());
     }
 
-    insts.emplace_back("pop"); // reserve top
-    return insts;
+    emit(InstCategory::ASSIGN, InstructionType::POP); // reserve top
 }
 
 /**
  * @brief PUSH all global variables into VM stack
  * @details global variables are initialized to zero, by ldc 0.
  */
-vector<Instruction> CodeGenerator::generateGlobalVariables() const
+void CodeGenerator::generateGlobalVariables()
 {
-    vector<Instruction> insts;
-
-    // { ScopeName: { VariableName: VariableAttribute } }
-    for (const auto &[_, v] : symbolTable.at(GLOBAL_SCOPE_NAME)) {
+    for (const VariableAttribute &v : symbolTable.at(0).variables) {
         // is array
         if (v.varSize > 0) {
             const int arrayBase = v.variableIndex + 1;
-            insts.emplace_back("ldc", std::to_string(arrayBase));
+            emit(InstCategory::GLOBAL_INIT, InstructionType::LDC, arrayBase);
         }
-        insts.emplace_back("push");
+        emit(InstCategory::GLOBAL_INIT, InstructionType::PUSH);
 
         int repeatCnt = v.varSize;
-        insts.emplace_back("ldc", "0");  // init to zero
+        emit(InstCategory::GLOBAL_INIT, InstructionType::LDC, 0);  // init to zero
         while (repeatCnt--) {
-            insts.emplace_back("push");
+            emit(InstCategory::GLOBAL_INIT, InstructionType::PUSH);
         }
     }
-    return insts;
 }
 
 /**
  * @brief automatically call main()
  * @see CodeGenerator::generateCall()
  */
-vector<Instruction> CodeGenerator::generateCallMain() const 
+void CodeGenerator::generateCallMain(int mainScope)
 {
-    vector<Instruction> insts;
+    generateFrame(symbolTable.at(mainScope), 0);
 
-    // std::cout << "Test'\n";
-
-    const auto &mainSymbolTable = symbolTable.at(MAIN_NAME);
-    const int n = mainSymbolTable.size();
-    vector<pair<string, VariableAttribute>> stackSeq(n);
-
-
-    // local vars
-    for (const auto &[k, v] : mainSymbolTable) {
-        stackSeq.at(n - v.variableIndex - 1) = {k, v};
-    }
-
-    // std::cout << "Set\n";
-
-    // push local vars
-    for (const auto &[_, v] : stackSeq) {
-        if (v.varSize == 0) {
-            insts.emplace_back("push");
-        } else {
-            int repeatCnt = v.varSize;
-            while (repeatCnt--) {
-                insts.emplace_back("push");
-            }
-            insts.emplace_back("addr", std::to_string(v.varSize));
-            insts.emplace_back("push");
-        }
-    }
-
-    insts.emplace_back("call", MAIN_NAME);
-
-    return insts;
+    callRelocations.push_back({baseOffset + emit(InstCategory::CALL_SETUP, InstructionType::CALL), mainScope});
 }
 
 /**
  * @brief Generate instructions before entering main()
  */
-vector<Instruction> CodeGenerator::generateBeforeMain() const 
+void CodeGenerator::generateBeforeMain(int mainScope)
 {
-    auto insts = generateGlobalVariables();
-    // std::cout << "after gv\n";
-    auto instsBeforeMain = generateCallMain();
-
-    appendInstructions(insts, instsBeforeMain);
-
-    return insts;
+    generateGlobalVariables();
+    generateCallMain(mainScope);
 }
 
 /**
- * @brief Entry of generating instrucions.
- * Then insert ret after all function code.
- * 
- * @return { FunctionId: Instructions } map.
+ * @brief Generate a function, then insert ret after its code
+ * (main() has no ret, it is the last function).
+ * @EBNF FuncDecl -> Type id '(' Params ')' CompoundStmt
  */
-InstructionMap CodeGenerator::createInstMap() const 
+void CodeGenerator::generateFunction(const AST *decl)
 {
-    // std::cout << "createIM\n";
-    InstructionMap instMap {
-        {GLOBAL_SCOPE_NAME, generateBeforeMain()}
-    };
-
-    for (const AST *const decl : root->getChildren()) {
-        auto children = decl->getChildren();
-        if (decl->getTokenType() == TokenType::FUNC_DECL) {
+    const auto &children = decl->getChildren();
+    const AST *idNode = children.at(1);
 
-            // FuncDecl -> Type id '(' Params ')' CompoundStmt
-            const auto &scopeName = children.at(1)->getTokenStr();
+    const int start = baseOffset + insts.size();
+    // functions may be declared after reset(), see generateEntryJump()
+    if (funcOffsets.size() < symbolTable.size()) {
+        funcOffsets.resize(symbolTable.size(), -1);
+    }
+    funcOffsets.at(idNode->getBinding().index) = start;
 
-            // std::cout << "in for loop\n";
+    const int outerLineNo = enterLine(decl->getLineNo());
 
-            // CompoundStmt -> '{' LocalVariableDecl StmtList '}'
-            auto insts = generateStmtList(children.at(3)->getChildren().at(1), scopeName);
+    // CompoundStmt -> '{' LocalVariableDecl StmtList '}'
+    generateStmtList(children.at(3)->getChildren().at(1));
 
-            if (scopeName != MAIN_NAME) {
-                insts.emplace_back("ret");
-            }
-            
-            instMap[scopeName] = insts;
-        }
+    if (idNode->getTokenId() != mainId) {
+        emit(InstCategory::CALL_TEARDOWN, InstructionType::RET);
     }
+    currentLineNo = outerLineNo;
 
-    return instMap;
+    funcSymbols.emplace_back(start, baseOffset + insts.size(), idNode->getTokenStr());
 }
 
 /**
- * @brief Reorder and merge the instructions all together, 
- * generate funcCallMap at th same time
- * 
- * @param instMap generated by CodeGenerator::createInstMap()
- * @param funcCallMap An empty map.
- * @return vector<Instruction> all instruction in the program
- * @return-by-reference unordered_map<string, int> &funcCallMap
- *     map functionId to instOffset.
+ * @brief Linker that resolves the callee of every call to an offset
  */
-vector<Instruction> CodeGenerator::mergeInstMap(const InstructionMap &instMap, unordered_map<string, int> &funcCallMap)
+void CodeGenerator::link()
 {
-    vector<Instruction> insts;
-    appendInstructions(insts, instMap.at(GLOBAL_SCOPE_NAME));
-
-    int instOffset = instMap.at(GLOBAL_SCOPE_NAME).size();
-
-    for (const auto &[k, v] : instMap) {
-        if (k != GLOBAL_SCOPE_NAME && k != MAIN_NAME) {
-            appendInstructions(insts, v);
+    for (const auto &[offset, scope] : callRelocations) {
+        insts.at(offset - baseOffset).operand = funcOffsets.at(scope) - offset;
+    }
+}
 
-            funcCallMap[k] = instOffset;
-            instOffset += v.size();
+/**
+ * @brief Write the buffered instructions and free them
+ * @details Calls to functions already generated are linked now, the
+ * others are written with a placeholder patched by linkWritten().
+ * Jumps never cross a function, flush between functions only.
+ */
+void CodeGenerator::flush(AsmStreamWriter &writer)
+{
+    vector<CallRelocation> pending;
+    vector<int> patchable;
+    for (const CallRelocation &relocation : callRelocations) {
+        const auto &[offset, scope] = relocation;
+        if (funcOffsetOf(scope) != -1) {
+            insts.at(offset - baseOffset).operand = funcOffsetOf(scope) - offset;
+        } else {
+            pending.push_back(relocation);
+            patchable.push_back(offset - baseOffset);
         }
     }
 
-    // append main code at last
-    appendInstructions(insts, instMap.at(MAIN_NAME));
-    funcCallMap[MAIN_NAME] = instOffset;
+    const vector<long long> positions = writer.write(insts, patchable);
+    for (int i = 0; i < pending.size(); i++) {
+        writtenCalls.push_back({positions.at(i), pending.at(i)});
+    }
 
-    return insts;
+    baseOffset += insts.size();
+    insts.clear();
+    callRelocations.clear();
 }
 
 /**
- * @brief Linker that transform ID call to OFFSET call
- * 
- * @param insts generated by CodeGenerator::mergeInstMap
- * @param funcCallMap generated by CodeGenerator::mergeInstMap
+ * @brief Linker of the flushed calls, once all functions are
  */
-void CodeGenerator::translateCall(vector<Instruction> &insts, const unordered_map<string, int> &funcCallMap)
-{
-    // linear scan
-    for (int i = 0; i < insts.size(); i++) {
-        if (insts.at(i).opcodeStr == "call") {
-            const int target = funcCallMap.at(insts.at(i).operandStr);
-            const int offset = target - i;
-            insts.at(i).operandStr = std::to_string(offset);
+void CodeGenerator::linkWritten(AsmStreamWriter &writer)
+{
+    for (const auto &[position, relocation] : writtenCalls) {
+        const int funcOffset = funcOffsetOf(relocation.scope);
+        if (funcOffset == -1) {
+            throwIdNotFoundErr(Interner::global().nameOf(symbolTable.at(relocation.scope).name));
         }
+        writer.patchOperand(position, funcOffset - relocation.offset);
     }
+    writtenCalls.clear();
 }
-
@@ -1,105 +1,158 @@
 #pragma once
 
-#include <unordered_map>
 #include "Instruction.h"
+#include "SymbolMap.h"
+#include "AsmStreamWriter.h"
 #include "AST.h"
-#include "Instruction.h"
+#include "ThreadPool.h"
 #include "frontend/SemanticAnalyzer.h"
 
 using std::pair;
 using std::string;
-using std::unordered_map;
 using std::vector;
 
-// { funcName: [ Instrucions ] }
-using InstructionMap = unordered_map<string, vector<Instruction>>;
-
+/**
+ * @brief Single-pass code emitter
+ *
+ * @details Instructions are appended to one buffer in a walk of the AST.
+ * Forward jumps are emitted with a placeholder offset and patched once
+ * their target is emitted; calls are linked after all functions are.
+ *
+ * Parallel: generate(pool) generates batches of functions apart, then
+ * merges them in the layout of generate(), so the code is the same.
+ *
+ * Streaming: generatePrelude(), then generateFunction() a function at a
+ * time (main() at last), flush() after each one so that only the code
+ * of one function is buffered, and linkWritten() at the end.
+ *
+ * Pipelined: generateEntryJump(), then the functions but main() as they
+ * are declared, generateLatePrelude() once all globals are, and main().
+ */
 class CodeGenerator
 {
 public:
-    CodeGenerator(AST *root, const SymbolTable &symbolTable) : root(root),
-                                                               symbolTable(symbolTable) {}
+    // root may be nullptr if generate() is not used
+    CodeGenerator(AST *root, const SymbolTable &symbolTable);
+
+    vector<Instruction> generate();
+
+    // same instructions as generate(), functions generated on pool
+    vector<Instruction> generate(ThreadPool &pool);
+
+    // global variables and the call to main()
+    void generatePrelude(int mainScope);
+
+    // jump to the prelude, generated later by generateLatePrelude()
+    void generateEntryJump();
+    void generateLatePrelude(int mainScope);
+
+    void generateFunction(const AST *decl);
+
+    // write the buffered code, calls to functions not generated yet are patched by linkWritten()
+    void flush(AsmStreamWriter &writer);
+
+    void linkWritten(AsmStreamWriter &writer);
 
-    vector<Instruction> generate() const;
+    // function ranges of the last generate(), sorted by start
+    const vector<FuncSymbol> &getFuncSymbols() const {
+        return funcSymbols;
+    }
 
 private:
     AST *root;
-    SymbolTable symbolTable;
+    const SymbolTable &symbolTable;
 
-    // inline const static string MAIN_NAME = "main";
+    const SymbolId inputId;
+    const SymbolId outputId;
+    const SymbolId mainId;
 
-    static void throwIdNotFoundErr(const string &id);
+    vector<FuncSymbol> funcSymbols;
+
+    // output buffer
+    vector<Instruction> insts;
+
+    // offset of insts.at(0), instructions before it are flushed
+    int baseOffset = 0;
+
+    // source line of the innermost Stmt / Expr being generated
+    int currentLineNo = 0;
+
+    // `call` to resolve by CodeGenerator::link()
+    struct CallRelocation {
+        int offset;
+        int scope; // of the callee
+    };
+    vector<CallRelocation> callRelocations;
 
-    vector<Instruction> generateLiteral(
-        const AST *root, const string &scopeName) const;
+    // flushed `call` to resolve by CodeGenerator::linkWritten()
+    struct WrittenCall {
+        long long position; // in the assembly file
+        CallRelocation relocation;
+    };
+    vector<WrittenCall> writtenCalls;
+
+    // offset of each function, by scope
+    vector<int> funcOffsets;
+
+    // -1 if not generated yet
+    int funcOffsetOf(int scope) const {
+        return scope < funcOffsets.size() ? funcOffsets[scope] : -1;
+    }
+
+    static void throwIdNotFoundErr(const string &id);
 
-    vector<Instruction> generateCompoundStmt(
-        const AST *root, const string &scopeName) const;
+    void reset();
 
-    vector<Instruction> generateStmtList(
-        const AST *root, const string &scopeName) const;
+    // FuncDecl of main(), the last one if many
+    const AST *findMain() const;
 
-    vector<Instruction> generateStmt(
-        const AST *root, const string &scopeName) const;
+    // append the code generated by part, from offset 0
+    void append(const CodeGenerator &part);
 
-    vector<Instruction> generateIfStmt(
-        const AST *root, const string &scopeName) const;
+    // append an instruction, return its index in insts
+    int emit(InstCategory category, InstructionType opcode, int operand = 0);
 
-    vector<Instruction> generateWhileStmt(
-        const AST *root, const string &scopeName) const;
+    // set the jump operand of insts[jumpOffset] to reach insts.size()
+    void patchJumpHere(int jumpOffset);
 
-    vector<Instruction> generateReturnStmt(
-        const AST *root, const string &scopeName) const;
+    // attribute instructions emitted from now on to lineNo (if known)
+    int enterLine(int lineNo);
 
-    vector<Instruction> generateExpr(
-        const AST *root, const string &scopeName) const;
+    void generateLiteral(const AST *root);
 
-    vector<Instruction> generateLoadVariable(
-        const AST *root, const string &scopeName) const;
+    void generateCompoundStmt(const AST *root);
 
-    vector<Instruction> generateSimpleExpr(
-        const AST *root, const string &scopeName) const;
+    void generateStmtList(const AST *root);
 
-    vector<Instruction> generateRelationOp(
-        const AST *root, const string &scopeName) const;
+    void generateStmt(const AST *root);
 
-    vector<Instruction> generateAddExpr(
-        const AST *root, const string &scopeName) const;
+    void generateIfStmt(const AST *root);
 
-    vector<Instruction> generateAddOp(
-        const AST *root, const string &scopeName) const;
+    void generateWhileStmt(const AST *root);
 
-    vector<Instruction> generateTerm(
-        const AST *root, const string &scopeName) const;
+    void generateReturnStmt(const AST *root);
 
-    vector<Instruction> generateMulOp(
-        const AST *root, const string &scopeName) const;
+    void generateExpr(const AST *root);
 
-    vector<Instruction> generateFactor(
-        const AST *root, const string &scopeName) const;
+    void generateLoadVariable(const AST *root);
 
-    vector<Instruction> generateCall(
-        const AST *root, const string &scopeName) const;
+    void generateBinaryExpr(const AST *root);
 
-    vector<Instruction> generateNativeCall(
-        const AST *root, const string &scopeName) const;
+    static InstructionType getBinaryOp(const AST *root);
 
-    vector<Instruction> generateArgList(
-        const AST *root, const string &scopeName) const;
+    void generateCall(const AST *root);
 
-    vector<Instruction> generateAssign(
-        const AST *root, const string &scopeName) const;
+    void generateArgList(const AST *root);
 
-    vector<Instruction> generateGlobalVariables() const;
+    void generateAssign(const AST *root);
 
-    vector<Instruction> generateCallMain() const;
+    void generateGlobalVariables();
 
-    vector<Instruction> generateBeforeMain() const;
+    void generateFrame(const Scope &scope, int paramSize);
 
-    InstructionMap createInstMap() const;
+    void generateCallMain(int mainScope);
 
-    static vector<Instruction> mergeInstMap(const InstructionMap &instMap, unordered_map<string, int> &funcCallMap);
+    void generateBeforeMain(int mainScope);
 
-    static void translateCall(vector<Instruction> &insts,
-                              const unordered_map<string, int> &funcCallMap);
+    void link();
 };
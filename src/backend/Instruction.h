@@ -1,16 +1,53 @@
 #pragma once
 
-#include <string>
+#include "InstructionType.h"
 
-using std::string;
+// Source construct an instruction is generated for
+enum class InstCategory
+{
+    NONE,
+    GLOBAL_INIT,   // global variables pushed before main()
+    CALL_SETUP,    // callee frame, arguments and call
+    CALL_TEARDOWN, // callee frame popped by the caller, ret
+    NATIVE_IO,     // input() / output()
+    LOAD,          // load variable
+    ARRAY_INDEX,   // array element address
+    ASSIGN,        // store variable
+    EXPR,          // literal, arithmetic and comparison
+    BRANCH,        // if-else jumps
+    LOOP,          // while jumps
+};
 
+const char *const INST_CATEGORY_NAMES[] = {
+    "none",
+    "global init",
+    "call setup",
+    "call teardown",
+    "native io",
+    "load",
+    "array index",
+    "assign",
+    "expr",
+    "branch",
+    "loop",
+};
+
+const int INST_CATEGORY_COUNT = sizeof(INST_CATEGORY_NAMES) / sizeof(INST_CATEGORY_NAMES[0]);
+
+// Compiler's instruction, with attributes for the symbol file and reports.
+// Mnemonics only appear when written by AssemblyFileIO::writeAsmFile().
 struct Instruction {
-    string opcodeStr;
-    string operandStr;
+    InstructionType opcode;
+    int operand;
+
+    // source line, 0 if unknown
+    int lineNo;
+
+    InstCategory category;
 
-    Instruction(string opcodeStr):
-        opcodeStr(opcodeStr), operandStr("") {}
+    Instruction(InstructionType opcode):
+        opcode(opcode), operand(0), lineNo(0), category(InstCategory::NONE) {}
 
-    Instruction(string opcodeStr, string operandStr):
-        opcodeStr(opcodeStr), operandStr(operandStr) {}
-};
\ No newline at end of file
+    Instruction(InstructionType opcode, int operand):
+        opcode(opcode), operand(operand), lineNo(0), category(InstCategory::NONE) {}
+};
@@ -85,13 +85,45 @@ const std::unordered_map<std::string, InstructionType> UNARY_INST_STR2TYPE{
     {"addr", InstructionType::ADDR},
 };
 
+// InstructionType to mnemonic, indexed by InstructionType
+const char *const INST_TYPE2STR[] = {
+    "add",
+    "sub",
+    "mul",
+    "div",
+
+    "lt",
+    "lte",
+    "gt",
+    "gte",
+    "eq",
+    "neq",
+
+    "ldc",
+    "ld",
+    "absld",
+    "st",
+    "absst",
+
+    "push",
+    "pop",
+
+    "jmp",
+    "jz",
+    "call",
+    "ret",
+    "addr",
+
+    "in",
+    "out",
+};
 
-// const std::unordered_map<InstructionType, std::string> UNARY_INST_TYPE2STR{
-//     {InstructionType::LDC, "ldc"},
-
-//     {InstructionType::JMP, "jmp"},
-//     {InstructionType::JZ, "jz"},
-//     {InstructionType::CALL, "call"},
-
-//     {InstructionType::ADDR, "addr"},
-// };
\ No newline at end of file
+// 1 operand
+inline bool isUnaryInst(InstructionType type)
+{
+    return type == InstructionType::LDC ||
+           type == InstructionType::JMP ||
+           type == InstructionType::JZ ||
+           type == InstructionType::CALL ||
+           type == InstructionType::ADDR;
+}
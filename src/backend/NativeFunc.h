@@ -8,16 +8,22 @@ class NativeFunc
 {
 public:
     template <typename T>
-    static T input()
+    static T input(std::istream &in = std::cin)
     {
         T ret;
-        std::cin >> ret;
+        in >> ret;
         return ret;
     }
 
+    template <typename T>
+    static void output(std::ostream &out, T t)
+    {
+        out << t << "\n";
+    }
+
     template <typename T>
     static void output(T t)
     {
-        std::cout << t << "\n";
+        output(std::cout, t);
     }
 };
@@ -0,0 +1,89 @@
+#include "SymbolMap.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <climits>
+
+void SymbolMap::load() const
+{
+    loaded = true;
+
+    std::ifstream readFile(symbolFilePath);
+    string line;
+
+    while (std::getline(readFile, line)) {
+        std::istringstream readLine(line);
+        string record;
+        readLine >> record;
+
+        if (record == "func") {
+            int start, end;
+            string name;
+            if (readLine >> start >> end >> name) {
+                funcs.emplace_back(start, end, name);
+            }
+        } else if (record == "line") {
+            int start, lineNo;
+            if (readLine >> start >> lineNo) {
+                lines.emplace_back(start, lineNo);
+            }
+        }
+        // unknown records are skipped
+    }
+
+    std::sort(funcs.begin(), funcs.end(), [](const FuncSymbol &a, const FuncSymbol &b) {
+        return a.start < b.start;
+    });
+    std::sort(lines.begin(), lines.end());
+}
+
+const FuncSymbol *SymbolMap::findFunc(int pc) const
+{
+    if (loaded == false) {
+        load();
+    }
+
+    // last function starting at or before pc
+    auto itr = std::upper_bound(funcs.begin(), funcs.end(), pc, [](int pc, const FuncSymbol &func) {
+        return pc < func.start;
+    });
+    if (itr == funcs.begin()) {
+        return nullptr;
+    }
+    --itr;
+
+    return pc < itr->end ? &*itr : nullptr;
+}
+
+string SymbolMap::getFuncName(int pc) const
+{
+    const FuncSymbol *func = findFunc(pc);
+    if (func == nullptr) {
+        return "fn@" + std::to_string(pc);
+    }
+    return func->name;
+}
+
+int SymbolMap::getLineNo(int pc) const
+{
+    if (loaded == false) {
+        load();
+    }
+
+    auto itr = std::upper_bound(lines.begin(), lines.end(), std::make_pair(pc, INT_MAX));
+    if (itr == lines.begin()) {
+        return 0;
+    }
+    return (itr - 1)->second;
+}
+
+string SymbolMap::getLocation(int pc) const
+{
+    const string funcName = getFuncName(pc);
+    const int lineNo = getLineNo(pc);
+    if (lineNo == 0) {
+        return funcName;
+    }
+    return funcName + ":" + std::to_string(lineNo);
+}
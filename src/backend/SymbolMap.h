@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// instructions [start, end) belong to function `name`
+struct FuncSymbol {
+    int start;
+    int end;
+    string name;
+
+    FuncSymbol(int start, int end, const string &name):
+        start(start), end(end), name(name) {}
+};
+
+/**
+ * @brief Function symbols of an assembly file, read from its sidecar
+ * symbol file (`out.s.sym`).
+ *
+ * @details The file is only opened on the first lookup, so a runtime
+ * that never asks for a name never pays for it. A missing file gives an
+ * empty map, and names fall back to entry offsets.
+ *
+ * Symbol file format, one record per line:
+ *     func START END NAME
+ *     line START LINENO   (until the next line record, 0 = unknown)
+ */
+class SymbolMap
+{
+public:
+    SymbolMap(const string &symbolFilePath): symbolFilePath(symbolFilePath), loaded(false) {}
+
+    // function containing pc, nullptr if unknown
+    const FuncSymbol *findFunc(int pc) const;
+
+    // name of the function containing pc, or "fn@<pc>"
+    string getFuncName(int pc) const;
+
+    // source line of the instruction at pc, 0 if unknown
+    int getLineNo(int pc) const;
+
+    // e.g. "quickSort:23", or "fn@4711"
+    string getLocation(int pc) const;
+
+    static string defaultPathOf(const string &asmFilePath) {
+        return asmFilePath + ".sym";
+    }
+
+private:
+    string symbolFilePath;
+
+    mutable bool loaded;
+    mutable vector<FuncSymbol> funcs; // sorted by start
+    mutable vector<std::pair<int, int>> lines; // { start, lineNo }, sorted by start
+
+    void load() const;
+};
@@ -1,15 +1,161 @@
 #include <stdexcept>
+#include <algorithm>
 #include "VM.h"
 #include "NativeFunc.h"
+#include "Probes.h"
+
+volatile std::sig_atomic_t VM::pollRequested = 0;
 
 void VM::run()
 {
+    stack.clear();
+    acc = 0;
+    base = NO_FRAME;
+    counters = VMCounters();
+    segmentStart = 0;
+
+    CMINUS_PROBE1(run__start, int(codes.size()));
+
+    if (monitors.empty())
+    {
+        runLoop<false>();
+    }
+    else
+    {
+        try
+        {
+            runLoop<true>();
+        }
+        catch (...)
+        {
+            syncInstCount();
+            for (auto monitor : monitors)
+            {
+                monitor->onRunAbort(*this);
+            }
+            throw;
+        }
+    }
+
+    CMINUS_PROBE1(run__end, pc);
+}
+
+template <bool monitored>
+void VM::runLoop()
+{
+    if constexpr (monitored)
+    {
+        for (auto monitor : monitors)
+        {
+            monitor->onRunStart(*this);
+        }
+    }
+
     for (pc = 0; pc < codes.size(); pc++)
     {
-        exec(codes[pc]);
+        exec<monitored>(codes[pc]);
+    }
+
+    if constexpr (monitored)
+    {
+        syncInstCount();
+        for (auto monitor : monitors)
+        {
+            monitor->onRunEnd(*this);
+        }
+    }
+}
+
+void VM::poll()
+{
+    pollRequested = 0;
+    syncInstCount();
+    for (auto monitor : monitors)
+    {
+        monitor->onPoll(*this);
+    }
+}
+
+void VM::raiseBackwardJump()
+{
+    for (auto monitor : flowMonitors)
+    {
+        monitor->onBackwardJump(*this);
+    }
+}
+
+void VM::raiseBranch(bool taken)
+{
+    for (auto monitor : flowMonitors)
+    {
+        monitor->onBranch(*this, taken);
+    }
+}
+
+void VM::raiseCall()
+{
+    for (auto monitor : flowMonitors)
+    {
+        monitor->onCall(*this);
     }
 }
 
+void VM::raiseRet()
+{
+    for (auto monitor : flowMonitors)
+    {
+        monitor->onRet(*this);
+    }
+}
+
+/**
+ * @brief Unwind the frames saved by CALL
+ *
+ * @param entries filled with the entry offset of every active function,
+ * innermost first. The code before main() is reported as entry 0.
+ * @details stack[base + 1] is OLD_BASE, stack[base + 2] is OLD_PC,
+ * which points to the caller's CALL instruction.
+ */
+void VM::walkFrames(vector<int> &entries) const
+{
+    entries.clear();
+
+    int frameBase = base;
+    int callPc;
+    while ((callPc = getCallPc(frameBase)) >= 0)
+    {
+        entries.push_back(callPc + codes[callPc].operand);
+        frameBase = stack[frameBase + 1];
+    }
+    entries.push_back(0);
+}
+
+/**
+ * @brief Entry offset of the running function, 0 before main()
+ */
+int VM::getFuncEntry() const
+{
+    const int callPc = getCallPc(base);
+    return callPc >= 0 ? callPc + codes[callPc].operand : 0;
+}
+
+// OLD_PC of the frame, -1 at NO_FRAME (or a clobbered frame)
+int VM::getCallPc(int frameBase) const
+{
+    if (frameBase < -1 || frameBase + 2 >= (int)stack.size())
+    {
+        return -1;
+    }
+
+    const int callPc = stack[frameBase + 2];
+    if (callPc < 0 || callPc >= (int)codes.size())
+    {
+        return -1;
+    }
+    return callPc;
+}
+
+template <bool monitored>
 void VM::exec(const VMInst &instruction)
 {
     switch (instruction.opcode)
@@ -76,6 +222,10 @@ void VM::exec(const VMInst &instruction)
 
     case InstructionType::PUSH:
         stack.push_back(acc);
+        if constexpr (monitored)
+        {
+            counters.peakStackSize = std::max(counters.peakStackSize, stack.size());
+        }
         break;
 
     case InstructionType::POP:
@@ -83,18 +233,62 @@ void VM::exec(const VMInst &instruction)
         break;
 
     case InstructionType::JMP:
+        if constexpr (monitored)
+        {
+            if (instruction.operand < 0)
+            {
+                if (flowMonitors.empty() == false)
+                {
+                    raiseBackwardJump();
+                }
+                pollIfRequested();
+            }
+            endSegment();
+        }
         // -1 is to dealing with pc++ in VM::run()
         pc += instruction.operand - 1;
+        if constexpr (monitored)
+        {
+            startSegment();
+        }
         break;
 
     case InstructionType::JZ:
+        if constexpr (monitored)
+        {
+            if (flowMonitors.empty() == false)
+            {
+                raiseBranch(acc == 0);
+            }
+            // never backward in generated code, but a loop all the same
+            if (instruction.operand < 0 && acc == 0)
+            {
+                pollIfRequested();
+            }
+            endSegment();
+        }
         if (acc == 0)
         {
             pc += instruction.operand - 1;
         }
+        if constexpr (monitored)
+        {
+            startSegment();
+        }
         break;
 
     case InstructionType::CALL:
+        if constexpr (monitored)
+        {
+            if (flowMonitors.empty() == false)
+            {
+                raiseCall();
+            }
+            pollIfRequested();
+            endSegment();
+        }
+        CMINUS_PROBE2(call, pc, pc + instruction.operand);
+
         // Locals ... Params
 
         stack.push_back(base);
@@ -107,13 +301,39 @@ void VM::exec(const VMInst &instruction)
         // Locals ... Params OLD_BASE OLD_PC
 
         pc += instruction.operand - 1;
+
+        if constexpr (monitored)
+        {
+            startSegment();
+            counters.callCount++;
+            counters.callDepth++;
+            counters.maxCallDepth = std::max(counters.maxCallDepth, counters.callDepth);
+            counters.peakStackSize = std::max(counters.peakStackSize, stack.size());
+        }
         break;
 
     case InstructionType::RET:
+        if constexpr (monitored)
+        {
+            if (flowMonitors.empty() == false)
+            {
+                raiseRet();
+            }
+            pollIfRequested();
+            endSegment();
+        }
+        CMINUS_PROBE2(ret, pc, stack.back());
+
         pc = stack.back();
         stack.pop_back();
         base = stack.back();
         stack.pop_back();
+
+        if constexpr (monitored)
+        {
+            startSegment();
+            counters.callDepth--;
+        }
         break;
 
     case InstructionType::ADDR:
@@ -122,12 +342,14 @@ void VM::exec(const VMInst &instruction)
 
     case InstructionType::IN:
         // scanf("%d", &acc);
-        acc = NativeFunc::input<int>();
+        acc = NativeFunc::input<int>(*input);
+        CMINUS_PROBE1(in, acc);
         break;
 
     case InstructionType::OUT:
         // printf("%d\n", acc);
-        NativeFunc::output(acc);
+        CMINUS_PROBE1(out, acc);
+        NativeFunc::output(*output, acc);
         break;
 
     default:
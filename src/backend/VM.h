@@ -2,18 +2,75 @@
 
 #include <vector>
 #include <string>
+#include <csignal>
+#include <iostream>
 #include "VMInst.h"
+#include "VMMonitor.h"
 
 using std::vector;
 using std::string;
 using std::pair;
 
+// Maintained by the monitored loop only, instCount is up to date in
+// VMMonitor::onPoll(), onRunEnd() and onRunAbort()
+struct VMCounters {
+    long long instCount = 0;
+    long long callCount = 0;
+    int callDepth = 0;
+    int maxCallDepth = 0;
+    size_t peakStackSize = 0;
+};
+
 class VM
 {
 public:
-    VM(const vector<VMInst> &codes): codes(codes) {}
+    VM(const vector<VMInst> &codes):
+        codes(codes), pc(0), acc(0), base(NO_FRAME),
+        input(&std::cin), output(&std::cout), segmentStart(0) {}
 
     void run();
+
+    // streams of the `in` / `out` native functions
+    void setIO(std::istream &input, std::ostream &output) {
+        this->input = &input;
+        this->output = &output;
+    }
+
+    void addMonitor(VMMonitor *monitor) {
+        monitors.push_back(monitor);
+        if (monitor->observesControlFlow()) {
+            flowMonitors.push_back(monitor);
+        }
+    }
+
+    // async-signal-safe, monitors get VMMonitor::onPoll() at the next safe point
+    static void requestPoll() {
+        pollRequested = 1;
+    }
+
+    void walkFrames(vector<int> &entries) const;
+    int getFuncEntry() const;
+
+    int getPc() const {
+        return pc;
+    }
+    int getStackSize() const {
+        return stack.size();
+    }
+    const vector<VMInst> &getCodes() const {
+        return codes;
+    }
+    const vector<int> &getStack() const {
+        return stack;
+    }
+    const VMCounters &getCounters() const {
+        return counters;
+    }
+
+    // old base saved by the outermost `call`, ends the frame chain
+    // (-1 is taken: it is the base of main() when the stack is empty)
+    const static int NO_FRAME = -2;
+
 private:
     // memory
     vector<VMInst> codes;
@@ -25,7 +82,59 @@ private:
     int base; // Stack Frame Pointer
     // int sp;// Stack Pointer (in VM, this can be achieved by stack.size())
 
-    void exec(const VMInst &instruction);
+    std::istream *input;
+    std::ostream *output;
+
+    vector<VMMonitor *> monitors;
+    vector<VMMonitor *> flowMonitors; // VMMonitor::observesControlFlow()
+    VMCounters counters;
+
+    // first pc of the straight-line code since the last jump, call or
+    // return: instCount is counted a segment at a time
+    int segmentStart;
+
+    static volatile std::sig_atomic_t pollRequested;
+
+    int getCallPc(int frameBase) const;
+
+    // count the segment ending with the jump, call or return at pc
+    void endSegment() {
+        counters.instCount += pc + 1 - segmentStart;
+    }
+
+    // pc: the next instruction minus 1, as left for the pc++ of runLoop()
+    void startSegment() {
+        segmentStart = pc + 1;
+    }
+
+    // count the instructions before pc
+    void syncInstCount() {
+        counters.instCount += pc - segmentStart;
+        segmentStart = pc;
+    }
+
+    void pollIfRequested() {
+        if (pollRequested) {
+            poll();
+        }
+    }
+
+    // out of line, so that exec() keeps few registers for the other
+    // instructions
+
+    void poll();
+
+    void raiseBackwardJump();
+    void raiseBranch(bool taken);
+    void raiseCall();
+    void raiseRet();
+
+    template <bool monitored>
+    void runLoop();
+
+    // inlined into runLoop(), not to save registers per instruction
+    template <bool monitored>
+    __attribute__((always_inline)) inline void exec(const VMInst &instruction);
 };
 
 /*
@@ -0,0 +1,46 @@
+#pragma once
+
+class VM;
+
+/**
+ * @brief Observer attached to a VM by runtime tools (profilers, ...).
+ *
+ * @details A VM without monitors runs the plain dispatch loop. Once a
+ * monitor is attached, VM::run() switches to the monitored loop, which
+ * calls back at safe points, i.e. between two instructions, where the
+ * registers and the frame chain are consistent. It does nothing per
+ * instruction, only at jumps, calls and returns.
+ */
+class VMMonitor
+{
+public:
+    virtual ~VMMonitor() {}
+
+    virtual void onRunStart(const VM &) {}
+
+    virtual void onRunEnd(const VM &) {}
+
+    // VM::run() stopped by an error instead of onRunEnd(), the error is
+    // rethrown after. May also follow a failed onRunStart() / onRunEnd().
+    virtual void onRunAbort(const VM &) {}
+
+    // VM::requestPoll() was signaled, called at the next backward jump,
+    // call or return, so still in the function running at the signal
+    virtual void onPoll(const VM &) {}
+
+    // false: the control flow events below are not raised to the monitor
+    virtual bool observesControlFlow() const {
+        return true;
+    }
+
+    // Control flow events, raised before the instruction at VM::getPc()
+    // (a JZ, CALL or RET) takes effect.
+    virtual void onBranch(const VM &, bool) {}
+
+    virtual void onCall(const VM &) {}
+
+    virtual void onRet(const VM &) {}
+
+    // JMP with a negative offset, i.e. a loop iteration
+    virtual void onBackwardJump(const VM &) {}
+};
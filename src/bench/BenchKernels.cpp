@@ -0,0 +1,200 @@
+#include "BenchKernels.h"
+
+#include <stdexcept>
+
+// unrolled body repetitions per outer loop round
+const int UNROLL = 32;
+
+// stack slot of the outer loop counter
+const int COUNTER_SLOT = 0;
+
+vector<VMInst> KernelAssembler::finish()
+{
+    for (const auto &[pc, label] : fixups) {
+        if (labels.find(label) == labels.end()) {
+            throw std::runtime_error("Undefined kernel label " + label);
+        }
+        codes[pc].operand = labels.at(label) - pc;
+    }
+    return codes;
+}
+
+void KernelAssembler::emitLoopBegin(int iterations)
+{
+    emit(InstructionType::LDC, iterations);
+    emit(InstructionType::PUSH);
+    label("loop");
+}
+
+void KernelAssembler::emitLoopEnd()
+{
+    // acc = stack[0] - 1
+    emit(InstructionType::LDC, COUNTER_SLOT);
+    emit(InstructionType::ABSLD);
+    emit(InstructionType::PUSH);
+    emit(InstructionType::LDC, 1);
+    emit(InstructionType::SUB);
+    emit(InstructionType::POP);
+
+    // stack[0] = acc
+    emit(InstructionType::PUSH);
+    emit(InstructionType::LDC, COUNTER_SLOT);
+    emit(InstructionType::ABSST);
+    emit(InstructionType::POP);
+
+    emit(InstructionType::LDC, COUNTER_SLOT);
+    emit(InstructionType::ABSLD);
+    emit(InstructionType::JZ, "end");
+    emit(InstructionType::JMP, "loop");
+    label("end");
+}
+
+/**
+ * @brief push / add / pop chains, acc += 1 through the stack
+ */
+vector<VMInst> BenchKernels::createAluKernel(int iterations)
+{
+    KernelAssembler assembler;
+    assembler.emitLoopBegin(iterations);
+    assembler.emit(InstructionType::LDC, 0);
+    for (int i = 0; i < UNROLL; i++) {
+        assembler.emit(InstructionType::PUSH);
+        assembler.emit(InstructionType::LDC, 1);
+        assembler.emit(InstructionType::ADD);
+        assembler.emit(InstructionType::POP);
+    }
+    assembler.emitLoopEnd();
+    return assembler.finish();
+}
+
+/**
+ * @brief ld / st between the locals of a frame, local[i + 1] = local[i]
+ */
+vector<VMInst> BenchKernels::createLdStKernel(int iterations)
+{
+    const int localSize = 4;
+
+    KernelAssembler assembler;
+    assembler.emit(InstructionType::LDC, iterations);
+    assembler.emit(InstructionType::PUSH);
+    for (int i = 0; i < localSize; i++) {
+        assembler.emit(InstructionType::PUSH);
+    }
+    // enter a frame like main() does, then fall through into the body
+    assembler.emit(InstructionType::CALL, "frame");
+    assembler.label("frame");
+    assembler.label("loop");
+    for (int i = 0; i < UNROLL; i++) {
+        assembler.emit(InstructionType::LDC, i % localSize);
+        assembler.emit(InstructionType::LD);
+        assembler.emit(InstructionType::PUSH);
+        assembler.emit(InstructionType::LDC, (i + 1) % localSize);
+        assembler.emit(InstructionType::ST);
+        assembler.emit(InstructionType::POP);
+    }
+    assembler.emitLoopEnd();
+    return assembler.finish();
+}
+
+/**
+ * @brief call / ret recursion, `depth` nested calls per round
+ */
+vector<VMInst> BenchKernels::createCallKernel(int iterations)
+{
+    const int depthSlot = 1;
+    const int depth = UNROLL;
+
+    KernelAssembler assembler;
+    assembler.emit(InstructionType::LDC, iterations);
+    assembler.emit(InstructionType::PUSH);
+    assembler.emit(InstructionType::PUSH); // depth slot
+    assembler.emit(InstructionType::JMP, "start");
+
+    // rec: if (stack[1]-- != 0) rec();
+    assembler.label("rec");
+    assembler.emit(InstructionType::LDC, depthSlot);
+    assembler.emit(InstructionType::ABSLD);
+    assembler.emit(InstructionType::JZ, "return");
+    assembler.emit(InstructionType::PUSH);
+    assembler.emit(InstructionType::LDC, 1);
+    assembler.emit(InstructionType::SUB);
+    assembler.emit(InstructionType::POP);
+    assembler.emit(InstructionType::PUSH);
+    assembler.emit(InstructionType::LDC, depthSlot);
+    assembler.emit(InstructionType::ABSST);
+    assembler.emit(InstructionType::POP);
+    assembler.emit(InstructionType::CALL, "rec");
+    assembler.label("return");
+    assembler.emit(InstructionType::RET);
+
+    assembler.label("start");
+    assembler.label("loop");
+    assembler.emit(InstructionType::LDC, depth);
+    assembler.emit(InstructionType::PUSH);
+    assembler.emit(InstructionType::LDC, depthSlot);
+    assembler.emit(InstructionType::ABSST);
+    assembler.emit(InstructionType::POP);
+    assembler.emit(InstructionType::CALL, "rec");
+    assembler.emitLoopEnd();
+    return assembler.finish();
+}
+
+/**
+ * @brief jz, alternately taken and not taken
+ */
+vector<VMInst> BenchKernels::createBranchKernel(int iterations)
+{
+    KernelAssembler assembler;
+    assembler.emitLoopBegin(iterations);
+    for (int i = 0; i < UNROLL; i++) {
+        const string skip = "skip" + std::to_string(i);
+        assembler.emit(InstructionType::LDC, i % 2);
+        assembler.emit(InstructionType::JZ, skip);
+        assembler.emit(InstructionType::LDC, 0);
+        assembler.label(skip);
+    }
+    assembler.emitLoopEnd();
+    return assembler.finish();
+}
+
+/**
+ * @brief absld / absst walk over an array, array[i] += 1
+ */
+vector<VMInst> BenchKernels::createArrayKernel(int iterations)
+{
+    const int arrayStart = 1;
+
+    KernelAssembler assembler;
+    assembler.emit(InstructionType::LDC, iterations);
+    assembler.emit(InstructionType::PUSH);
+    assembler.emit(InstructionType::LDC, 0);
+    for (int i = 0; i < UNROLL; i++) {
+        assembler.emit(InstructionType::PUSH);
+    }
+    assembler.label("loop");
+    for (int i = 0; i < UNROLL; i++) {
+        assembler.emit(InstructionType::LDC, arrayStart + i);
+        assembler.emit(InstructionType::ABSLD);
+        assembler.emit(InstructionType::PUSH);
+        assembler.emit(InstructionType::LDC, 1);
+        assembler.emit(InstructionType::ADD);
+        assembler.emit(InstructionType::POP);
+        assembler.emit(InstructionType::PUSH);
+        assembler.emit(InstructionType::LDC, arrayStart + i);
+        assembler.emit(InstructionType::ABSST);
+        assembler.emit(InstructionType::POP);
+    }
+    assembler.emitLoopEnd();
+    return assembler.finish();
+}
+
+vector<BenchKernel> BenchKernels::create(int iterations)
+{
+    return {
+        {"alu", "push / ldc / add / pop chains", createAluKernel(iterations)},
+        {"ldst", "ld / st between frame locals", createLdStKernel(iterations)},
+        {"call", "call / ret recursion", createCallKernel(iterations)},
+        {"branch", "jz, alternately taken", createBranchKernel(iterations)},
+        {"array", "absld / absst array walk", createArrayKernel(iterations)},
+    };
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "backend/VMInst.h"
+
+using std::string;
+using std::vector;
+
+struct BenchKernel {
+    string name;
+    string description;
+    vector<VMInst> codes;
+};
+
+/**
+ * @brief Synthetic instruction streams stressing one opcode group each
+ *
+ * @details Every kernel is an outer loop of `iterations` rounds around an
+ * unrolled body, so the loop bookkeeping stays a small fraction of the
+ * executed instructions. They need no input and produce no output.
+ */
+class BenchKernels
+{
+public:
+    static vector<BenchKernel> create(int iterations);
+
+private:
+    static vector<VMInst> createAluKernel(int iterations);
+    static vector<VMInst> createLdStKernel(int iterations);
+    static vector<VMInst> createCallKernel(int iterations);
+    static vector<VMInst> createBranchKernel(int iterations);
+    static vector<VMInst> createArrayKernel(int iterations);
+};
+
+/**
+ * @brief Tiny assembler with labels for the kernels
+ *
+ * @details Jump and call operands are pc-relative, as in linked code.
+ */
+class KernelAssembler
+{
+public:
+    void emit(InstructionType opcode, int operand = 0) {
+        codes.emplace_back(opcode, operand);
+    }
+
+    // jmp / jz / call to label, resolved by finish()
+    void emit(InstructionType opcode, const string &label) {
+        fixups.push_back({codes.size(), label});
+        codes.emplace_back(opcode, 0);
+    }
+
+    void label(const string &name) {
+        labels[name] = codes.size();
+    }
+
+    vector<VMInst> finish();
+
+    // stack[0] = n, loop counter of the outer loop
+    void emitLoopBegin(int iterations);
+    // --stack[0], back to the loop start while non-zero
+    void emitLoopEnd();
+
+private:
+    vector<VMInst> codes;
+    std::unordered_map<string, int> labels;
+    vector<std::pair<int, string>> fixups;
+};
@@ -0,0 +1,195 @@
+#include "LexerBench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include "frontend/CharScan.h"
+
+const string LexerBench::WELCOME_PROMPT = "Lexer throughput benchmark for C-Minus. \nOptions";
+
+bool LexerBench::readArgs(int argc, char **argv) {
+    namespace bpo = boost::program_options;
+
+    bpo::options_description desc(WELCOME_PROMPT);
+    desc.add_options()
+        ("help,h", "Show help message.")
+        ("input,i", bpo::value<vector<string>>(&inputFilePaths)->multitoken(), "Lex source files <arg>... (e.g. generated by tests/bench/gen_source.py).")
+        ("engine,e", bpo::value<string>(&engineFilter), "Run engine <arg> only (reference, fast, parallel).")
+        ("jobs,j", bpo::value<int>(&jobs)->default_value(0), "Threads of the parallel engine (0: one per core).")
+        ("warmup", bpo::value<int>(&warmup)->default_value(1), "Untimed runs before measuring.")
+        ("repeat,r", bpo::value<int>(&repeat)->default_value(10), "Timed runs, the median is reported.")
+        ("format,f", bpo::value<string>(&format)->default_value("text"), "Output format (text, json or csv).");
+
+    bpo::variables_map var_map;
+    try {
+        bpo::store(bpo::parse_command_line(argc, argv, desc), var_map);
+
+        if (var_map.find("help") != var_map.end()) {
+            std::cout << desc << "\n";
+            return false;
+        }
+
+        bpo::notify(var_map);
+    } catch (std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return false;
+    } catch (...) {
+        std::cerr << "Unknown error during readArgs! \n";
+        return false;
+    }
+
+    if (inputFilePaths.empty()) {
+        std::cout << desc << "\n";
+        return false;
+    }
+    if (warmup < 0 || repeat <= 0) {
+        std::cerr << "Error: repeat must be positive\n";
+        return false;
+    }
+    if (jobs < 0) {
+        std::cerr << "Error: jobs must not be negative\n";
+        return false;
+    }
+    if (jobs == 0) {
+        jobs = ThreadPool::defaultThreadCount();
+    }
+    if (format != "text" && format != "json" && format != "csv") {
+        std::cerr << "Error: unknown format " << format << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+void LexerBench::runAll() {
+    try {
+        ThreadPool pool(jobs);
+        const Engine parallel = [&pool](const Lexer &lexer) {
+            return lexer.parallelLexicalAnalysis(pool);
+        };
+
+        for (const auto &inputFilePath : inputFilePaths) {
+            const Lexer lexer(inputFilePath);
+
+            const auto referenceTokens = lexer.referenceLexicalAnalysis();
+            checkSameTokens("fast", lexer.lexicalAnalysis(), referenceTokens);
+            checkSameTokens("parallel", parallel(lexer), referenceTokens);
+
+            measure("reference", &Lexer::referenceLexicalAnalysis, lexer, inputFilePath);
+            measure("fast", &Lexer::lexicalAnalysis, lexer, inputFilePath);
+            measure("parallel", parallel, lexer, inputFilePath);
+        }
+    } catch (std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return;
+    }
+
+    if (format == "json") {
+        std::cout << toJson() << "\n";
+    } else if (format == "csv") {
+        printCsv(std::cout);
+    } else {
+        print(std::cout);
+    }
+}
+
+void LexerBench::measure(const string &engineName, Engine engine, const Lexer &lexer, const string &inputFilePath)
+{
+    if (engineFilter.empty() == false && engineFilter != engineName) {
+        return;
+    }
+
+    size_t tokenCount = 0;
+    for (int i = 0; i < warmup; i++) {
+        tokenCount = engine(lexer).size();
+    }
+
+    vector<double> runNs;
+    for (int i = 0; i < repeat; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        tokenCount = engine(lexer).size();
+        const auto end = std::chrono::steady_clock::now();
+        runNs.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+    }
+    std::sort(runNs.begin(), runNs.end());
+
+    const size_t bytes = lexer.getSource().size();
+    const double medianNs = runNs[runNs.size() / 2];
+    results.push_back({
+        inputFilePath, engineName, bytes, tokenCount, repeat,
+        runNs.front(), medianNs,
+        bytes / 1e6 / (medianNs / 1e9),
+        tokenCount / (medianNs / 1e9)
+    });
+}
+
+void LexerBench::checkSameTokens(const string &engineName, const vector<Token> &tokens,
+                                 const vector<Token> &referenceTokens)
+{
+    const size_t count = std::min(tokens.size(), referenceTokens.size());
+    for (size_t i = 0; i < count; i++) {
+        const Token &token = tokens[i];
+        const Token &reference = referenceTokens[i];
+        if (token.getTokenType() != reference.getTokenType() ||
+            token.getOffset() != reference.getOffset() ||
+            token.getLength() != reference.getLength() ||
+            token.getLineNo() != reference.getLineNo()) {
+            throw std::runtime_error((
+                boost::format("Engine %s differs from reference at token %d (line: %d, reference line: %d)")
+                % engineName % i % token.getLineNo() % reference.getLineNo()
+            ).str());
+        }
+    }
+    if (tokens.size() != referenceTokens.size()) {
+        throw std::runtime_error((
+            boost::format("Engine %s returns %d tokens, reference %d")
+            % engineName % tokens.size() % referenceTokens.size()
+        ).str());
+    }
+}
+
+void LexerBench::print(std::ostream &out) const
+{
+    out << "scanner: " << CharScan::engineName() << ", parallel jobs: " << jobs << "\n";
+    out << boost::format("%-24s %-10s %10s %12s %12s %12s %10s %14s\n")
+        % "input" % "engine" % "MB" % "tokens" % "min (ms)" % "median (ms)" % "MB/s" % "tokens/s";
+    for (const auto &result : results) {
+        out << boost::format("%-24s %-10s %10.2f %12d %12.3f %12.3f %10.1f %14.4g\n")
+            % result.input % result.engine % (result.bytes / 1e6) % result.tokenCount
+            % (result.minNs / 1e6) % (result.medianNs / 1e6)
+            % result.mbPerSec % result.tokensPerSec;
+    }
+}
+
+void LexerBench::printCsv(std::ostream &out) const
+{
+    out << "input,engine,scanner,bytes,tokens,repeat,min_ns,median_ns,mb_per_sec,tokens_per_sec\n";
+    for (const auto &result : results) {
+        out << boost::format("%s,%s,%s,%d,%d,%d,%.0f,%.0f,%.2f,%.0f\n")
+            % result.input % result.engine % CharScan::engineName() % result.bytes % result.tokenCount
+            % result.repeat % result.minNs % result.medianNs % result.mbPerSec % result.tokensPerSec;
+    }
+}
+
+Json::Value LexerBench::toJson() const
+{
+    Json::Value ret = Json::arrayValue;
+    for (const auto &result : results) {
+        Json::Value row;
+        row["input"] = result.input;
+        row["engine"] = result.engine;
+        row["scanner"] = CharScan::engineName();
+        row["bytes"] = Json::UInt64(result.bytes);
+        row["tokens"] = Json::UInt64(result.tokenCount);
+        row["repeat"] = result.repeat;
+        row["min_ns"] = result.minNs;
+        row["median_ns"] = result.medianNs;
+        row["mb_per_sec"] = result.mbPerSec;
+        row["tokens_per_sec"] = result.tokensPerSec;
+        ret.append(row);
+    }
+    return ret;
+}
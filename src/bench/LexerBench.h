@@ -0,0 +1,62 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <json/json.h>
+#include "frontend/Lexer.h"
+
+using std::string;
+using std::vector;
+
+struct LexerBenchResult {
+    string input;
+    string engine;
+    size_t bytes;
+    size_t tokenCount;
+    int repeat;
+    double minNs;    // per run
+    double medianNs;
+    double mbPerSec; // of the median run
+    double tokensPerSec;
+};
+
+/**
+ * @brief Throughput of the Lexer alone, on source files already in memory
+ *
+ * @details An engine is a Lexer method returning the tokens of the
+ * source (`parallel` on a pool of --jobs threads). Every engine must return the same tokens as the reference one
+ * (the char by char state machine), or the bench fails.
+ */
+class LexerBench
+{
+public:
+    LexerBench() {}
+
+    bool readArgs(int argc, char **argv);
+    void runAll();
+
+private:
+    using Engine = std::function<vector<Token>(const Lexer &)>;
+
+    vector<string> inputFilePaths;
+    string engineFilter;
+    int warmup = 0;
+    int repeat = 0;
+    int jobs = 0;
+    string format;
+
+    vector<LexerBenchResult> results;
+
+    void measure(const string &engineName, Engine engine, const Lexer &lexer, const string &inputFilePath);
+
+    static void checkSameTokens(const string &engineName, const vector<Token> &tokens,
+                                const vector<Token> &referenceTokens);
+
+    void print(std::ostream &out) const;
+    void printCsv(std::ostream &out) const;
+    Json::Value toJson() const;
+
+    const static string WELCOME_PROMPT;
+};
@@ -0,0 +1,118 @@
+#include "VMBench.h"
+
+#include <iostream>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+
+const string VMBench::WELCOME_PROMPT = "Opcode-level microbenchmarks for C-Minus VM. \nOptions";
+
+bool VMBench::readArgs(int argc, char **argv) {
+    namespace bpo = boost::program_options;
+
+    bpo::options_description desc(WELCOME_PROMPT);
+    desc.add_options()
+        ("help,h", "Show help message.")
+        ("kernel,k", bpo::value<string>(&kernelFilter), "Run kernel <arg> only (alu, ldst, call, branch, array).")
+        ("engine,e", bpo::value<string>(&engineFilter), "Run engine <arg> only (vm, vm-monitored).")
+        ("iterations,n", bpo::value<int>(&iterations)->default_value(100000), "Outer loop rounds of each kernel.")
+        ("warmup", bpo::value<int>(&warmup)->default_value(2), "Untimed runs before measuring.")
+        ("repeat,r", bpo::value<int>(&repeat)->default_value(10), "Timed runs, the median is reported.")
+        ("format,f", bpo::value<string>(&format)->default_value("text"), "Output format (text, json or csv).");
+
+    bpo::variables_map var_map;
+    try {
+        bpo::store(bpo::parse_command_line(argc, argv, desc), var_map);
+
+        if (var_map.find("help") != var_map.end()) {
+            std::cout << desc << "\n";
+            return false;
+        }
+
+        bpo::notify(var_map);
+    } catch (std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return false;
+    } catch (...) {
+        std::cerr << "Unknown error during readArgs! \n";
+        return false;
+    }
+
+    if (iterations <= 0 || repeat <= 0) {
+        std::cerr << "Error: iterations and repeat must be positive\n";
+        return false;
+    }
+    if (warmup < 0) {
+        std::cerr << "Error: --warmup must not be negative\n";
+        return false;
+    }
+    if (format != "text" && format != "json" && format != "csv") {
+        std::cerr << "Error: unknown format " << format << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+void VMBench::runAll() {
+    try {
+        for (const auto &kernel : BenchKernels::create(iterations)) {
+            if (kernelFilter.empty() == false && kernelFilter != kernel.name) {
+                continue;
+            }
+
+            measure<VM>("vm", kernel);
+            measure<MonitoredVM>("vm-monitored", kernel);
+        }
+    } catch (std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return;
+    }
+
+    if (format == "json") {
+        std::cout << toJson() << "\n";
+    } else if (format == "csv") {
+        printCsv(std::cout);
+    } else {
+        print(std::cout);
+    }
+}
+
+void VMBench::print(std::ostream &out) const
+{
+    out << boost::format("%-8s %-14s %14s %12s %12s %10s %14s\n")
+        % "kernel" % "engine" % "insts" % "min (ms)" % "median (ms)" % "ns/inst" % "inst/s";
+    for (const auto &result : results) {
+        out << boost::format("%-8s %-14s %14d %12.3f %12.3f %10.3f %14.4g\n")
+            % result.kernel % result.engine % result.instCount
+            % (result.minNs / 1e6) % (result.medianNs / 1e6)
+            % result.nsPerInst % result.instPerSec;
+    }
+}
+
+void VMBench::printCsv(std::ostream &out) const
+{
+    out << "kernel,engine,insts,repeat,min_ns,median_ns,ns_per_inst,inst_per_sec\n";
+    for (const auto &result : results) {
+        out << boost::format("%s,%s,%d,%d,%.0f,%.0f,%.4f,%.0f\n")
+            % result.kernel % result.engine % result.instCount % result.repeat
+            % result.minNs % result.medianNs % result.nsPerInst % result.instPerSec;
+    }
+}
+
+Json::Value VMBench::toJson() const
+{
+    Json::Value ret = Json::arrayValue;
+    for (const auto &result : results) {
+        Json::Value row;
+        row["kernel"] = result.kernel;
+        row["engine"] = result.engine;
+        row["insts"] = Json::Int64(result.instCount);
+        row["repeat"] = result.repeat;
+        row["min_ns"] = result.minNs;
+        row["median_ns"] = result.medianNs;
+        row["ns_per_inst"] = result.nsPerInst;
+        row["inst_per_sec"] = result.instPerSec;
+        ret.append(row);
+    }
+    return ret;
+}
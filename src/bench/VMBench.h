@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <json/json.h>
+#include "backend/VM.h"
+#include "BenchKernels.h"
+
+using std::string;
+using std::vector;
+
+struct BenchResult {
+    string kernel;
+    string engine;
+    long long instCount; // per run
+    int repeat;
+    double minNs;        // per run
+    double medianNs;
+    double nsPerInst;    // of the median run
+    double instPerSec;
+};
+
+/**
+ * @brief VM attached to a monitor that does nothing,
+ * i.e. the cost of the monitored dispatch loop itself
+ */
+class MonitoredVM : public VM
+{
+public:
+    MonitoredVM(const vector<VMInst> &codes): VM(codes) {
+        addMonitor(&monitor);
+    }
+
+private:
+    VMMonitor monitor;
+};
+
+/**
+ * @brief Opcode-level microbenchmarks of the VM
+ *
+ * @details An engine is any class constructible from the code,
+ * with a run() method executing it from the start, e.g. VM. Register a
+ * new engine variant in VMBench::runAll() to compare it with the others.
+ */
+class VMBench
+{
+public:
+    VMBench() {}
+
+    bool readArgs(int argc, char **argv);
+    void runAll();
+
+private:
+    string kernelFilter;
+    string engineFilter;
+    int iterations = 0;
+    int warmup = 0;
+    int repeat = 0;
+    string format;
+
+    vector<BenchResult> results;
+
+    template <typename Engine>
+    void measure(const string &engineName, const BenchKernel &kernel);
+
+    void print(std::ostream &out) const;
+    void printCsv(std::ostream &out) const;
+    Json::Value toJson() const;
+
+    const static string WELCOME_PROMPT;
+};
+
+template <typename Engine>
+void VMBench::measure(const string &engineName, const BenchKernel &kernel)
+{
+    if (engineFilter.empty() == false && engineFilter != engineName) {
+        return;
+    }
+
+    // the monitored loop counts the executed instructions
+    MonitoredVM counter(kernel.codes);
+    counter.run();
+    const long long instCount = counter.getCounters().instCount;
+
+    Engine engine(kernel.codes);
+    for (int i = 0; i < warmup; i++) {
+        engine.run();
+    }
+
+    vector<double> runNs;
+    for (int i = 0; i < repeat; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        engine.run();
+        const auto end = std::chrono::steady_clock::now();
+        runNs.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+    }
+    std::sort(runNs.begin(), runNs.end());
+
+    const double medianNs = runNs[runNs.size() / 2];
+    results.push_back({
+        kernel.name, engineName, instCount, repeat,
+        runNs.front(), medianNs,
+        medianNs / instCount,
+        instCount / (medianNs / 1e9)
+    });
+}
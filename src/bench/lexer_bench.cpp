@@ -0,0 +1,12 @@
+#include "LexerBench.h"
+
+int main(int argc, char **argv)
+{
+    LexerBench lexerBench;
+    bool flag = lexerBench.readArgs(argc, argv);
+    if (flag) {
+        lexerBench.runAll();
+    }
+
+    return 0;
+}
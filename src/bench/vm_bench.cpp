@@ -0,0 +1,12 @@
+#include "VMBench.h"
+
+int main(int argc, char **argv)
+{
+    VMBench vmBench;
+    bool flag = vmBench.readArgs(argc, argv);
+    if (flag) {
+        vmBench.runAll();
+    }
+
+    return 0;
+}
@@ -4,8 +4,8 @@ int main(int argc, char **argv)
 {
     Runtime runtime;
     bool flag = runtime.readArgs(argc, argv);
-    if (flag) {
-        runtime.execCode();
+    if (flag && runtime.execCode() == false) {
+        return 1;
     }
 
     return 0;
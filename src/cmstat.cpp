@@ -0,0 +1,12 @@
+#include "LiveStatsViewer.h"
+
+int main(int argc, char **argv)
+{
+    LiveStatsViewer liveStatsViewer;
+    bool flag = liveStatsViewer.readArgs(argc, argv);
+    if (flag) {
+        liveStatsViewer.view();
+    }
+
+    return 0;
+}
@@ -0,0 +1,12 @@
+#include "TraceDecoder.h"
+
+int main(int argc, char **argv)
+{
+    TraceDecoder traceDecoder;
+    bool flag = traceDecoder.readArgs(argc, argv);
+    if (flag) {
+        traceDecoder.decode();
+    }
+
+    return 0;
+}
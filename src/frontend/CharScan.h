@@ -0,0 +1,308 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "TokenType.h"
+
+#if !defined(CMINUS_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define CMINUS_SCAN_AVX2
+#elif !defined(CMINUS_NO_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#define CMINUS_SCAN_SSE2
+#endif
+
+enum class CharClass : uint8_t
+{
+    INVALID,
+    END,      // '\0'
+    SPACE,    // including '\n'
+    ID_START, // alpha or underscore
+    DIGIT,
+    SINGLE,   // one-char token, e.g. '+' or '{'
+    OPERATOR, // one-char token, or two-char one if followed by '=', e.g. '<' or '<='
+    NOT,      // '!', only valid in "!="
+    SLASH,    // divide or comment
+};
+
+struct CharInfo {
+    CharClass charClass = CharClass::INVALID;
+    TokenType single = TokenType::END;
+    TokenType withEqual = TokenType::END;
+};
+
+// CharInfo of every char
+struct CharTable {
+    CharInfo info[256];
+
+    constexpr CharTable() {
+        for (int c = 'a'; c <= 'z'; c++) {
+            info[c].charClass = CharClass::ID_START;
+            info[c - 'a' + 'A'].charClass = CharClass::ID_START;
+        }
+        info['_'].charClass = CharClass::ID_START;
+        for (int c = '0'; c <= '9'; c++) {
+            info[c].charClass = CharClass::DIGIT;
+        }
+        // same as isspace
+        const char spaces[] = {' ', '\t', '\n', '\v', '\f', '\r'};
+        for (char c : spaces) {
+            info[static_cast<unsigned char>(c)].charClass = CharClass::SPACE;
+        }
+        info[0].charClass = CharClass::END;
+
+        single('+', TokenType::PLUS);
+        single('-', TokenType::MINUS);
+        single('*', TokenType::MULTIPLY);
+        single(';', TokenType::SEMICOLON);
+        single(',', TokenType::COMMA);
+        single('(', TokenType::LEFT_ROUND_BRACKET);
+        single(')', TokenType::RIGHT_ROUND_BRACKET);
+        single('[', TokenType::LEFT_SQUARE_BRACKET);
+        single(']', TokenType::RIGHT_SQUARE_BRACKET);
+        single('{', TokenType::LEFT_CURLY_BRACKET);
+        single('}', TokenType::RIGHT_CURLY_BRACKET);
+
+        info['/'] = {CharClass::SLASH, TokenType::DIVIDE, TokenType::END};
+        info['<'] = {CharClass::OPERATOR, TokenType::LESS, TokenType::LESS_EQUAL};
+        info['>'] = {CharClass::OPERATOR, TokenType::GREATER, TokenType::GREATER_EQUAL};
+        info['='] = {CharClass::OPERATOR, TokenType::ASSIGN, TokenType::EQUAL};
+        info['!'] = {CharClass::NOT, TokenType::END, TokenType::NOT_EQUAL};
+    }
+
+    constexpr void single(char c, TokenType tokenType) {
+        info[static_cast<unsigned char>(c)] = {CharClass::SINGLE, tokenType, TokenType::END};
+    }
+};
+
+/**
+ * @brief Char classes of the Lexer and scanning of runs of chars
+ *
+ * @details The scanners read the text in aligned blocks of 32 (AVX2) or
+ * 16 (SSE2) bytes, which may start before p and end after the '\0'.
+ * Without SSE2 (or with -DCMINUS_NO_SIMD) they read char by char.
+ * Every scanner stops at '\0'.
+ *
+ * Precondition of the scanners: p points into a text that starts at an
+ * ALIGNMENT boundary, ends with '\0', and is followed by readable bytes
+ * up to the next ALIGNMENT boundary, e.g. a SourceBuffer.
+ */
+class CharScan
+{
+public:
+    // of the texts scanned, a multiple of the block size of every engine
+    static constexpr size_t ALIGNMENT = 32;
+
+    static const CharInfo &infoOf(char c) {
+        return TABLE.info[static_cast<unsigned char>(c)];
+    }
+
+    // first char that is not alpha, digit or underscore
+    static const char *skipIdChars(const char *p);
+
+    // first char that is not a digit
+    static const char *skipDigits(const char *p);
+
+    // first char that is not whitespace, lineNo += '\n' skipped
+    static const char *skipSpaces(const char *p, int &lineNo);
+
+    // first '\n' or '\0'
+    static const char *findLineEnd(const char *p);
+
+    // first '*' or '\0', lineNo += '\n' skipped
+    static const char *findStar(const char *p, int &lineNo);
+
+    // "avx2", "sse2" or "scalar"
+    static const char *engineName();
+
+private:
+    static constexpr CharTable TABLE{};
+
+    static bool isIdChar(char c) {
+        const CharClass charClass = infoOf(c).charClass;
+        return charClass == CharClass::ID_START || charClass == CharClass::DIGIT;
+    }
+
+#if defined(CMINUS_SCAN_AVX2)
+    static constexpr int WIDTH = 32;
+    static constexpr uint32_t ALL = 0xFFFFFFFFu;
+    using Vector = __m256i;
+
+    static Vector load(const char *block) {
+        return _mm256_load_si256(reinterpret_cast<const __m256i *>(block));
+    }
+    static Vector eq(Vector v, char c) {
+        return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+    }
+    // lo <= c <= hi, for ASCII lo and hi
+    static Vector inRange(Vector v, char lo, char hi) {
+        return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+                                _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+    }
+    static Vector either(Vector a, Vector b) {
+        return _mm256_or_si256(a, b);
+    }
+    static uint32_t bitsOf(Vector v) {
+        return static_cast<uint32_t>(_mm256_movemask_epi8(v));
+    }
+#elif defined(CMINUS_SCAN_SSE2)
+    static constexpr int WIDTH = 16;
+    static constexpr uint32_t ALL = 0xFFFFu;
+    using Vector = __m128i;
+
+    static Vector load(const char *block) {
+        return _mm_load_si128(reinterpret_cast<const __m128i *>(block));
+    }
+    static Vector eq(Vector v, char c) {
+        return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+    }
+    // lo <= c <= hi, for ASCII lo and hi
+    static Vector inRange(Vector v, char lo, char hi) {
+        return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                             _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), v));
+    }
+    static Vector either(Vector a, Vector b) {
+        return _mm_or_si128(a, b);
+    }
+    static uint32_t bitsOf(Vector v) {
+        return static_cast<uint32_t>(_mm_movemask_epi8(v));
+    }
+#endif
+
+#if defined(CMINUS_SCAN_AVX2) || defined(CMINUS_SCAN_SSE2)
+    /**
+     * @brief First char at or after p whose bit is set in stop(block)
+     *
+     * @details If CountLines, lineNo += '\n' before that char.
+     */
+    template <bool CountLines, typename Stop>
+    static const char *scan(const char *p, int &lineNo, Stop stop) {
+        const int offset = reinterpret_cast<uintptr_t>(p) % WIDTH;
+        const char *block = p - offset;
+        uint32_t wanted = (ALL << offset) & ALL;
+
+        while (true) {
+            const Vector v = load(block);
+            const uint32_t stops = stop(v) & wanted;
+            if (stops != 0) {
+                if (CountLines) {
+                    const uint32_t before = (stops & -stops) - 1;
+                    lineNo += __builtin_popcount(bitsOf(eq(v, '\n')) & wanted & before);
+                }
+                return block + __builtin_ctz(stops);
+            }
+            if (CountLines) {
+                lineNo += __builtin_popcount(bitsOf(eq(v, '\n')) & wanted);
+            }
+            block += WIDTH;
+            wanted = ALL;
+        }
+    }
+#endif
+};
+
+#if defined(CMINUS_SCAN_AVX2) || defined(CMINUS_SCAN_SSE2)
+
+inline const char *CharScan::skipIdChars(const char *p)
+{
+    int unused = 0;
+    return scan<false>(p, unused, [](Vector v) {
+        const Vector alpha = either(inRange(v, 'a', 'z'), inRange(v, 'A', 'Z'));
+        const Vector idChar = either(alpha, either(inRange(v, '0', '9'), eq(v, '_')));
+        return ~bitsOf(idChar);
+    });
+}
+
+inline const char *CharScan::skipDigits(const char *p)
+{
+    int unused = 0;
+    return scan<false>(p, unused, [](Vector v) {
+        return ~bitsOf(inRange(v, '0', '9'));
+    });
+}
+
+inline const char *CharScan::skipSpaces(const char *p, int &lineNo)
+{
+    return scan<true>(p, lineNo, [](Vector v) {
+        return ~bitsOf(either(eq(v, ' '), inRange(v, '\t', '\r')));
+    });
+}
+
+inline const char *CharScan::findLineEnd(const char *p)
+{
+    int unused = 0;
+    return scan<false>(p, unused, [](Vector v) {
+        return bitsOf(either(eq(v, '\n'), eq(v, '\0')));
+    });
+}
+
+inline const char *CharScan::findStar(const char *p, int &lineNo)
+{
+    return scan<true>(p, lineNo, [](Vector v) {
+        return bitsOf(either(eq(v, '*'), eq(v, '\0')));
+    });
+}
+
+inline const char *CharScan::engineName()
+{
+#if defined(CMINUS_SCAN_AVX2)
+    return "avx2";
+#else
+    return "sse2";
+#endif
+}
+
+#else
+
+inline const char *CharScan::skipIdChars(const char *p)
+{
+    while (isIdChar(*p)) {
+        p++;
+    }
+    return p;
+}
+
+inline const char *CharScan::skipDigits(const char *p)
+{
+    while (infoOf(*p).charClass == CharClass::DIGIT) {
+        p++;
+    }
+    return p;
+}
+
+inline const char *CharScan::skipSpaces(const char *p, int &lineNo)
+{
+    while (infoOf(*p).charClass == CharClass::SPACE) {
+        if (*p == '\n') {
+            lineNo++;
+        }
+        p++;
+    }
+    return p;
+}
+
+inline const char *CharScan::findLineEnd(const char *p)
+{
+    while (*p != '\n' && *p != '\0') {
+        p++;
+    }
+    return p;
+}
+
+inline const char *CharScan::findStar(const char *p, int &lineNo)
+{
+    while (*p != '*' && *p != '\0') {
+        if (*p == '\n') {
+            lineNo++;
+        }
+        p++;
+    }
+    return p;
+}
+
+inline const char *CharScan::engineName()
+{
+    return "scalar";
+}
+
+#endif
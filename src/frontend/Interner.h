@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using std::string;
+
+// index of an interned string, dense from 0
+using SymbolId = int;
+
+/**
+ * @brief String interner shared by the whole compiler
+ *
+ * @details Every token text is interned once by the Parser, and AST
+ * nodes and symbol tables only hold its SymbolId. Two texts are equal
+ * iff their ids are, and the text of an id stays valid (and at the same
+ * address) until the process exits.
+ *
+ * Thread-safe: intern() locks, nameOf() doesn't. Names are stored in
+ * blocks that are never moved nor reallocated, so the name of an id can
+ * be read while other ids are interned.
+ */
+class Interner
+{
+public:
+    SymbolId intern(std::string_view str) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        const auto iter = ids.find(str);
+        if (iter != ids.end()) {
+            return iter->second;
+        }
+
+        // names never move, so the key can view into them
+        const SymbolId id = count.load(std::memory_order_relaxed);
+        std::unique_ptr<string[]> &block = blocks[id >> BLOCK_BITS];
+        if (block == nullptr) {
+            block.reset(new string[BLOCK_SIZE]);
+        }
+        string &name = block[id & (BLOCK_SIZE - 1)];
+        name = str;
+        ids.emplace(name, id);
+        count.store(id + 1, std::memory_order_release);
+        return id;
+    }
+
+    const string &nameOf(SymbolId id) const {
+        return blocks[id >> BLOCK_BITS][id & (BLOCK_SIZE - 1)];
+    }
+
+    int size() const {
+        return count.load(std::memory_order_acquire);
+    }
+
+    static Interner &global() {
+        static Interner interner;
+        return interner;
+    }
+
+private:
+    static constexpr int BLOCK_BITS = 16;
+    static constexpr int BLOCK_SIZE = 1 << BLOCK_BITS;
+    // blocks of all non-negative SymbolIds
+    static constexpr int MAX_BLOCKS = 1 << (31 - BLOCK_BITS);
+
+    std::unique_ptr<string[]> blocks[MAX_BLOCKS];
+    std::atomic<int> count{0};
+
+    // guards ids and the writes of blocks
+    std::mutex mutex;
+    std::unordered_map<std::string_view, SymbolId> ids;
+};
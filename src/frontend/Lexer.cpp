@@ -1,9 +1,14 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <fstream>
 #include <stdexcept>
 #include <cctype>
 #include <boost/format.hpp>
+#include "CharScan.h"
 #include "Lexer.h"
 #include "Token.h"
 #include "TokenType.h"
@@ -11,19 +16,435 @@
 using std::string;
 using std::vector;
 
+namespace {
+
+struct KeywordSlot {
+    std::string_view text;
+    TokenType tokenType = TokenType::IDENTIFIER;
+};
+
+constexpr size_t KEYWORD_SLOTS = 16;
+
+// perfect for the keywords, checked below; length >= 2
+constexpr size_t keywordHash(const char *tokenBegin, size_t length)
+{
+    return (tokenBegin[0] + 4 * tokenBegin[1] + 2 * length) % KEYWORD_SLOTS;
+}
+
+// KEYWORD_MAP by keywordHash
+struct KeywordTable {
+    KeywordSlot slots[KEYWORD_SLOTS];
+    size_t minLength = SIZE_MAX;
+    size_t maxLength = 0;
+    bool perfect = true;
+
+    constexpr KeywordTable() {
+        add("void", TokenType::VOID);
+        add("int", TokenType::INT);
+        add("char", TokenType::CHAR);
+        add("float", TokenType::FLOAT);
+        add("double", TokenType::DOUBLE);
+        add("if", TokenType::IF);
+        add("else", TokenType::ELSE);
+        add("while", TokenType::WHILE);
+        add("return", TokenType::RETURN);
+    }
+
+    constexpr void add(std::string_view text, TokenType tokenType) {
+        KeywordSlot &slot = slots[keywordHash(text.data(), text.size())];
+        if (slot.text.empty() == false) {
+            perfect = false;
+        }
+        slot = {text, tokenType};
+        minLength = text.size() < minLength ? text.size() : minLength;
+        maxLength = text.size() > maxLength ? text.size() : maxLength;
+    }
+};
+
+constexpr KeywordTable KEYWORD_TABLE{};
+
+static_assert(KEYWORD_TABLE.perfect, "keywords collide, change keywordHash");
+static_assert(KEYWORD_TABLE.minLength >= 2, "keywordHash reads 2 chars");
+
+Token shiftLineNo(const Token &token, int lineDelta)
+{
+    return Token(token.getTokenType(), token.getOffset(), token.getLength(), token.getLineNo() + lineDelta);
+}
+
+}
+
 vector<Token> Lexer::lexicalAnalysis() const
 {
     vector<Token> result;
-
-    std::ifstream inputFile(readFilePath);
-    string text;
     int curLineNo = 1;
 
-    // read until '\0' (which means EOF)
-    std::getline(inputFile, text, _EOF);
+    // the source ends with '\0' (which means EOF)
+    const char *text = source.data();
+    const char *textPtr = text;
+    while (true)
+    {
+        result.push_back(scanToken(text, textPtr, curLineNo));
+
+        if (result.back().getTokenType() == TokenType::END)
+        {
+            break;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief Lex the source a batch at a time, e.g. for another thread
+ * @param textPtr source.data() to start, then where the last batch ended
+ * @param lineNo 1 to start
+ * @return true once END is appended to tokens
+ */
+bool Lexer::lexBatch(const char *&textPtr, int &lineNo, size_t count, vector<Token> &tokens) const
+{
+    const char *text = source.data();
+    for (size_t i = 0; i < count; i++)
+    {
+        tokens.push_back(scanToken(text, textPtr, lineNo));
+
+        if (tokens.back().getTokenType() == TokenType::END)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Lex chunks of the source on the pool, then merge them
+ *
+ * @details Chunks start at line starts, so no token straddles two of
+ * them, but a chunk may start inside a multiline comment: each one is
+ * lexed speculatively, as if it did not, and after an error (e.g. an
+ * apostrophe in such a comment) again from the next line.
+ * The merge walks the chunks in order, knowing the token cur that the
+ * sequential lexer returns next. Once a chunk has a token at the offset
+ * of cur, the chunk agrees with the sequential lexer from there on (a
+ * token only depends on the text from its first char) up to its next
+ * error, which is then a real one, and its tokens are taken, lines
+ * shifted. Otherwise cur is lexed on sequentially until they meet, e.g.
+ * at the first token after the comment.
+ * Every '\n' is counted once, in a comment or not, so a chunk's lines
+ * are all shifted by the same delta.
+ */
+vector<Token> Lexer::parallelLexicalAnalysis(ThreadPool &pool) const
+{
+    const size_t chunkCount = std::min<size_t>(pool.size() * 4, source.size() / MIN_CHUNK_BYTES);
+    if (pool.size() <= 1 || chunkCount <= 1)
+    {
+        return lexicalAnalysis();
+    }
+
+    const char *text = source.data();
+    const vector<size_t> bounds = splitChunks(chunkCount);
+    vector<LexedChunk> chunks(bounds.size() - 1);
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        chunks[i].begin = bounds[i];
+        chunks[i].end = bounds[i + 1];
+    }
+    pool.parallelFor(chunks.size(), [&](size_t i) {
+        lexChunk(text, chunks[i]);
+    });
+
+    // 1. merge into runs of tokens, copied by 2.
+    struct Run {
+        const vector<Token> *tokens; // a chunk's or relexed
+        size_t first;
+        size_t count;
+        int lineDelta;
+        size_t resultIndex;
+    };
+    vector<Run> runs;
+    vector<Token> relexed;
+    size_t resultSize = 0;
+
+    const char *textPtr = text;
+    int lineNo = 1;
+    Token cur = scanToken(text, textPtr, lineNo);
+    for (const LexedChunk &chunk : chunks)
+    {
+        const vector<Token> &tokens = chunk.tokens;
+        size_t k = 0;
+        while (cur.getTokenType() != TokenType::END && cur.getOffset() < chunk.end)
+        {
+            k = std::lower_bound(tokens.begin() + k, tokens.end(), cur.getOffset(),
+                                 [](const Token &token, uint64_t offset) {
+                                     return token.getOffset() < offset;
+                                 }) - tokens.begin();
+
+            if (k < tokens.size() && tokens[k].getOffset() == cur.getOffset())
+            {
+                // in sync up to the next error
+                const auto error = std::upper_bound(chunk.errorsAfter.begin(), chunk.errorsAfter.end(), k);
+                const size_t segmentEnd = error == chunk.errorsAfter.end() ? tokens.size() : *error;
+                const int lineDelta = cur.getLineNo() - tokens[k].getLineNo();
+                runs.push_back({&tokens, k, segmentEnd - k, lineDelta, resultSize});
+                resultSize += segmentEnd - k;
+                k = segmentEnd;
+
+                if (error == chunk.errorsAfter.end() && chunk.failed == false)
+                {
+                    cur = shiftLineNo(chunk.next, lineDelta);
+                    break;
+                }
+                // lex the error again, to report it at its line
+                const Token last = shiftLineNo(tokens[segmentEnd - 1], lineDelta);
+                textPtr = text + last.getOffset() + last.getLength();
+                lineNo = last.getLineNo();
+                cur = scanToken(text, textPtr, lineNo);
+            }
+            else
+            {
+                if (runs.empty() == false && runs.back().tokens == &relexed)
+                {
+                    runs.back().count++;
+                }
+                else
+                {
+                    runs.push_back({&relexed, relexed.size(), 1, 0, resultSize});
+                }
+                relexed.push_back(cur);
+                resultSize++;
+
+                textPtr = text + cur.getOffset() + cur.getLength();
+                lineNo = cur.getLineNo();
+                cur = scanToken(text, textPtr, lineNo);
+            }
+        }
+    }
+
+    // 2. copy, in even ranges of the result
+    vector<Token> result(resultSize + 1);
+    const size_t rangeCount = std::min(resultSize, chunks.size());
+    pool.parallelFor(rangeCount, [&](size_t i) {
+        const size_t begin = resultSize * i / rangeCount;
+        const size_t end = resultSize * (i + 1) / rangeCount;
+        size_t r = std::upper_bound(runs.begin(), runs.end(), begin,
+                                    [](size_t index, const Run &run) {
+                                        return index < run.resultIndex;
+                                    }) - runs.begin() - 1;
+        for (size_t index = begin; index < end; r++)
+        {
+            const Run &run = runs[r];
+            const size_t to = std::min(run.count, end - run.resultIndex);
+            for (size_t j = index - run.resultIndex; j < to; j++)
+            {
+                result[run.resultIndex + j] = shiftLineNo((*run.tokens)[run.first + j], run.lineDelta);
+            }
+            index = run.resultIndex + to;
+        }
+    });
+    result.back() = cur; // END
+
+    return result;
+}
+
+vector<size_t> Lexer::splitChunks(size_t chunkCount) const
+{
+    const char *text = source.data();
+    const size_t size = source.size();
+
+    vector<size_t> bounds{0};
+    for (size_t i = 1; i < chunkCount; i++)
+    {
+        const size_t target = size / chunkCount * i;
+        if (target <= bounds.back())
+        {
+            continue;
+        }
+        const void *lineEnd = std::memchr(text + target, '\n', size - target);
+        if (lineEnd == nullptr)
+        {
+            break;
+        }
+        const size_t lineStart = static_cast<const char *>(lineEnd) - text + 1;
+        if (lineStart < size)
+        {
+            bounds.push_back(lineStart);
+        }
+    }
+    bounds.push_back(size);
+
+    return bounds;
+}
+
+void Lexer::lexChunk(const char *text, LexedChunk &chunk)
+{
+    const char *textPtr = text + chunk.begin;
+    int lineNo = 1;
+    while (true)
+    {
+        try
+        {
+            while (true)
+            {
+                const Token token = scanToken(text, textPtr, lineNo);
+                if (token.getTokenType() == TokenType::END || token.getOffset() >= chunk.end)
+                {
+                    chunk.next = token;
+                    return;
+                }
+                chunk.tokens.push_back(token);
+            }
+        }
+        catch (const std::runtime_error &)
+        {
+            // may be text of a comment indeed, left to the merge
+            chunk.errorsAfter.push_back(chunk.tokens.size());
+        }
+
+        // textPtr is still on the line of the error
+        const char *chunkEnd = text + chunk.end;
+        const void *lineEnd = std::memchr(textPtr, '\n', chunkEnd - std::min(textPtr, chunkEnd));
+        if (lineEnd == nullptr || static_cast<const char *>(lineEnd) + 1 >= chunkEnd)
+        {
+            chunk.errorsAfter.pop_back();
+            chunk.failed = true;
+            return;
+        }
+        textPtr = static_cast<const char *>(lineEnd) + 1;
+        lineNo++;
+    }
+}
+
+Token Lexer::scanToken(const char *text, const char *&textPtr, int &lineNo)
+{
+    while (true)
+    {
+        // most tokens are apart by one space
+        if (*textPtr == ' ')
+        {
+            textPtr++;
+        }
+
+        const char *tokenBegin = textPtr;
+        const CharInfo &info = CharScan::infoOf(*textPtr);
+
+        switch (info.charClass)
+        {
+            case CharClass::SPACE:
+                textPtr = CharScan::skipSpaces(textPtr, lineNo);
+                break;
+
+            case CharClass::ID_START:
+                textPtr = CharScan::skipIdChars(textPtr + 1);
+                return makeToken(keywordOf(tokenBegin, textPtr - tokenBegin), text, tokenBegin, textPtr, lineNo);
+
+            case CharClass::DIGIT:
+                textPtr = CharScan::skipDigits(textPtr + 1);
+                return makeToken(TokenType::LITERAL, text, tokenBegin, textPtr, lineNo);
+
+            case CharClass::SINGLE:
+                textPtr++;
+                return makeToken(info.single, text, tokenBegin, textPtr, lineNo);
+
+            case CharClass::OPERATOR:
+                if (textPtr[1] == '=')
+                {
+                    textPtr += 2;
+                    return makeToken(info.withEqual, text, tokenBegin, textPtr, lineNo);
+                }
+                textPtr++;
+                return makeToken(info.single, text, tokenBegin, textPtr, lineNo);
+
+            case CharClass::NOT:
+                if (textPtr[1] != '=')
+                {
+                    throwInvalidCharErr(textPtr[1], lineNo);
+                }
+                textPtr += 2;
+                return makeToken(info.withEqual, text, tokenBegin, textPtr, lineNo);
+
+            case CharClass::SLASH:
+                if (textPtr[1] == '/')
+                {
+                    // the '\n' is left to SPACE, which counts it
+                    textPtr = CharScan::findLineEnd(textPtr + 2);
+                }
+                else if (textPtr[1] == '*')
+                {
+                    textPtr = skipMultilineComment(textPtr + 2, lineNo);
+                }
+                else
+                {
+                    textPtr++;
+                    return makeToken(info.single, text, tokenBegin, textPtr, lineNo);
+                }
+                break;
+
+            case CharClass::END:
+                return makeToken(TokenType::END, text, tokenBegin, textPtr, lineNo);
 
-    const char *textPtr = text.c_str();
-    Token curToken = getNextToken(textPtr, curLineNo);
+            default:
+                throwInvalidCharErr(*textPtr, lineNo);
+        }
+    }
+}
+
+const char *Lexer::skipMultilineComment(const char *textPtr, int &lineNo)
+{
+    while (true)
+    {
+        textPtr = CharScan::findStar(textPtr, lineNo);
+        if (*textPtr == _EOF)
+        {
+            // unterminated, ends with the source
+            return textPtr;
+        }
+
+        while (*textPtr == '*')
+        {
+            textPtr++;
+        }
+        if (*textPtr == '/')
+        {
+            return textPtr + 1;
+        }
+    }
+}
+
+TokenType Lexer::keywordOf(const char *tokenBegin, size_t length)
+{
+    if (length < KEYWORD_TABLE.minLength || length > KEYWORD_TABLE.maxLength)
+    {
+        return TokenType::IDENTIFIER;
+    }
+
+    const KeywordSlot &slot = KEYWORD_TABLE.slots[keywordHash(tokenBegin, length)];
+    if (slot.text == std::string_view(tokenBegin, length))
+    {
+        return slot.tokenType;
+    }
+    return TokenType::IDENTIFIER;
+}
+
+Token Lexer::makeToken(TokenType tokenType, const char *text,
+                       const char *tokenBegin, const char *tokenEnd, int lineNo)
+{
+    const size_t length = tokenEnd - tokenBegin;
+    if (length > Token::MAX_LENGTH) {
+        throw std::runtime_error((
+            boost::format("Token too long (%d chars) in line: %d") % length % lineNo
+        ).str());
+    }
+    return Token(tokenType, tokenBegin - text, length, lineNo);
+}
+
+vector<Token> Lexer::referenceLexicalAnalysis() const
+{
+    vector<Token> result;
+    int curLineNo = 1;
+
+    // the source ends with '\0' (which means EOF)
+    const char *text = source.data();
+    const char *textPtr = text;
+    Token curToken = getNextToken(text, textPtr, curLineNo);
     while (true)
     {
         result.push_back(curToken);
@@ -32,7 +453,7 @@ vector<Token> Lexer::lexicalAnalysis() const
         {
             break;
         }
-        curToken = getNextToken(textPtr, curLineNo);
+        curToken = getNextToken(text, textPtr, curLineNo);
     }
 
     return result;
@@ -45,23 +466,17 @@ void Lexer::throwInvalidCharErr(char curChar, int lineNo)
     ).str());
 }
 
-inline void Lexer::pushAndForward(const char *&textPtr, string &tokenStr) 
-{
-    tokenStr.push_back(*textPtr);
-    textPtr++;
-}
-
-void Lexer::forwardStart(const char *&textPtr, LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &lineNo)
+void Lexer::forwardStart(const char *&textPtr, LexingState &lexingState, TokenType &tokenType, const char *, int &lineNo)
 {
     if (isalpha(*textPtr) || *textPtr == '_')
     {
         lexingState = LexingState::IN_ID;
-        pushAndForward(textPtr, tokenStr);
+        textPtr++;
     }
     else if (isdigit(*textPtr))
     {
         lexingState = LexingState::IN_LITERAL;
-        pushAndForward(textPtr, tokenStr);
+        textPtr++;
     }
     else if (*textPtr == '\n') 
     {
@@ -79,19 +494,19 @@ void Lexer::forwardStart(const char *&textPtr, LexingState &lexingState, TokenTy
             case '+':
                 lexingState = LexingState::DONE;
                 tokenType = TokenType::PLUS;
-                pushAndForward(textPtr, tokenStr);
+                textPtr++;
                 break;
 
             case '-':
                 lexingState = LexingState::DONE;
                 tokenType = TokenType::MINUS;
-                pushAndForward(textPtr, tokenStr);
+                textPtr++;
                 break;
 
             case '*':
                 lexingState = LexingState::DONE;
                 tokenType = TokenType::MULTIPLY;
-                pushAndForward(textPtr, tokenStr);
+                textPtr++;
                 break;
 
             case '/':
@@ -101,70 +516,70 @@ void Lexer::forwardStart(const char *&textPtr, LexingState &lexingState, TokenTy
 
             case '<':
                 lexingState = LexingState::IN_LESS;
-                pushAndForward(textPtr, tokenStr);
+                textPtr++;
                 break;
 
             case '>':
                 lexingState = LexingState::IN_GREATER;
-                pushAndForward(textPtr, tokenStr);
+                textPtr++;
                 break;
 
             case '=':
                 lexingState = LexingState::IN_EQUAL;
-                pushAndForward(textPtr, tokenStr);
+                textPtr++;
                 break;
 
             case '!':
                 lexingState = LexingState::IN_NOT;
-                pushAndForward(textPtr, tokenStr);
+                textPtr++;
                 break;
 
             case ';':
                 lexingState = LexingState::DONE;
                 tokenType = TokenType::SEMICOLON;
-                pushAndForward(textPtr, tokenStr);
+                textPtr++;
                 break;
 
             case ',':
                 lexingState = LexingState::DONE;
                 tokenType = TokenType::COMMA;
-                pushAndForward(textPtr, tokenStr);
+                textPtr++;
                 break;
 
             case '(':
                 lexingState = LexingState::DONE;
                 tokenType = TokenType::LEFT_ROUND_BRACKET;
-                pushAndForward(textPtr, tokenStr);
+                textPtr++;
                 break;
 
             case ')':
                 lexingState = LexingState::DONE;
                 tokenType = TokenType::RIGHT_ROUND_BRACKET;
-                pushAndForward(textPtr, tokenStr);
+                textPtr++;
                 break;
 
             case '[':
                 lexingState = LexingState::DONE;
                 tokenType = TokenType::LEFT_SQUARE_BRACKET;
-                pushAndForward(textPtr, tokenStr);
+                textPtr++;
                 break;
 
             case ']':
                 lexingState = LexingState::DONE;
                 tokenType = TokenType::RIGHT_SQUARE_BRACKET;
-                pushAndForward(textPtr, tokenStr);
+                textPtr++;
                 break;
 
             case '{':
                 lexingState = LexingState::DONE;
                 tokenType = TokenType::LEFT_CURLY_BRACKET;
-                pushAndForward(textPtr, tokenStr);
+                textPtr++;
                 break;
 
             case '}':
                 lexingState = LexingState::DONE;
                 tokenType = TokenType::RIGHT_CURLY_BRACKET;
-                pushAndForward(textPtr, tokenStr);
+                textPtr++;
                 break;
 
             case _EOF: 
@@ -178,19 +593,20 @@ void Lexer::forwardStart(const char *&textPtr, LexingState &lexingState, TokenTy
     }
 }
 
-void Lexer::forwardId(const char *&textPtr, LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &)
+void Lexer::forwardId(const char *&textPtr, LexingState &lexingState, TokenType &tokenType, const char *tokenBegin, int &)
 {
     // alpha or underscore or digit
     if (isalpha(*textPtr) || *textPtr == '_' || isdigit(*textPtr))
     {
-        pushAndForward(textPtr, tokenStr);
+        textPtr++;
     }
     else 
     {
         lexingState = LexingState::DONE;
-        if (KEYWORD_MAP.find(tokenStr) != KEYWORD_MAP.end()) 
+        auto keywordIter = KEYWORD_MAP.find(string(tokenBegin, textPtr));
+        if (keywordIter != KEYWORD_MAP.end()) 
         {
-            tokenType = KEYWORD_MAP.at(tokenStr);
+            tokenType = keywordIter->second;
         } 
         else 
         {
@@ -199,11 +615,11 @@ void Lexer::forwardId(const char *&textPtr, LexingState &lexingState, TokenType
     }
 }
 
-void Lexer::forwardLiteral(const char *&textPtr, LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &) 
+void Lexer::forwardLiteral(const char *&textPtr, LexingState &lexingState, TokenType &tokenType, const char *, int &) 
 {
     if (isdigit(*textPtr))
     {
-        pushAndForward(textPtr, tokenStr);
+        textPtr++;
     }
     else 
     {
@@ -212,7 +628,7 @@ void Lexer::forwardLiteral(const char *&textPtr, LexingState &lexingState, Token
     }
 }
 
-void Lexer::forwardSlash(const char *&textPtr, LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &)
+void Lexer::forwardSlash(const char *&textPtr, LexingState &lexingState, TokenType &tokenType, const char *, int &)
 {
     if (*textPtr == '*')
     {
@@ -228,12 +644,18 @@ void Lexer::forwardSlash(const char *&textPtr, LexingState &lexingState, TokenTy
     {
         lexingState = LexingState::DONE;
         tokenType = TokenType::DIVIDE;
-        tokenStr = "/";
     }
 }
 
-void Lexer::forwardSinglelineComment(const char *&textPtr, LexingState &lexingState, TokenType &, string &, int &lineNo)
+void Lexer::forwardSinglelineComment(const char *&textPtr, LexingState &lexingState, TokenType &, const char *, int &lineNo)
 {
+    if (*textPtr == _EOF)
+    {
+        // unterminated, ends with the source
+        lexingState = LexingState::START;
+        return;
+    }
+
     if (*textPtr == '\n') 
     {
         lineNo++;
@@ -242,8 +664,15 @@ void Lexer::forwardSinglelineComment(const char *&textPtr, LexingState &lexingSt
     textPtr++;
 }
 
-void Lexer::forwardMultilineComment(const char *&textPtr, LexingState &lexingState, TokenType &, string &, int &lineNo)
+void Lexer::forwardMultilineComment(const char *&textPtr, LexingState &lexingState, TokenType &, const char *, int &lineNo)
 {
+    if (*textPtr == _EOF)
+    {
+        // unterminated, ends with the source
+        lexingState = LexingState::START;
+        return;
+    }
+
     if (*textPtr == '*')
     {
         lexingState = LexingState::END_MULTILINE_COMMENT;
@@ -255,8 +684,15 @@ void Lexer::forwardMultilineComment(const char *&textPtr, LexingState &lexingSta
     textPtr++;
 }
 
-void Lexer::forwardEndMultilineComment(const char *&textPtr, LexingState &lexingState, TokenType &, string &, int &lineNo)
+void Lexer::forwardEndMultilineComment(const char *&textPtr, LexingState &lexingState, TokenType &, const char *, int &lineNo)
 {
+    if (*textPtr == _EOF)
+    {
+        // unterminated, ends with the source
+        lexingState = LexingState::START;
+        return;
+    }
+
     if (*textPtr == '/')
     {
         lexingState = LexingState::START;
@@ -274,12 +710,12 @@ void Lexer::forwardEndMultilineComment(const char *&textPtr, LexingState &lexing
     textPtr++;
 }
 
-void Lexer::forwardLess(const char *&textPtr, LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &)
+void Lexer::forwardLess(const char *&textPtr, LexingState &lexingState, TokenType &tokenType, const char *, int &)
 {
     if (*textPtr == '=')
     {
         tokenType = TokenType::LESS_EQUAL;
-        pushAndForward(textPtr, tokenStr);
+        textPtr++;
     }
     else
     {
@@ -289,12 +725,12 @@ void Lexer::forwardLess(const char *&textPtr, LexingState &lexingState, TokenTyp
     lexingState = LexingState::DONE;
 }
 
-void Lexer::forwardGreater(const char *&textPtr, LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &)
+void Lexer::forwardGreater(const char *&textPtr, LexingState &lexingState, TokenType &tokenType, const char *, int &)
 {
     if (*textPtr == '=')
     {
         tokenType = TokenType::GREATER_EQUAL;
-        pushAndForward(textPtr, tokenStr);
+        textPtr++;
     }
     else
     {
@@ -303,12 +739,12 @@ void Lexer::forwardGreater(const char *&textPtr, LexingState &lexingState, Token
     lexingState = LexingState::DONE;
 }
 
-void Lexer::forwardEqual(const char *&textPtr, LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &)
+void Lexer::forwardEqual(const char *&textPtr, LexingState &lexingState, TokenType &tokenType, const char *, int &)
 {
     if (*textPtr == '=')
     {
         tokenType = TokenType::EQUAL;
-        pushAndForward(textPtr, tokenStr);
+        textPtr++;
     }
     else
     {
@@ -317,13 +753,13 @@ void Lexer::forwardEqual(const char *&textPtr, LexingState &lexingState, TokenTy
     lexingState = LexingState::DONE;
 }
 
-void Lexer::forwardNot(const char *&textPtr, LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &lineNo)
+void Lexer::forwardNot(const char *&textPtr, LexingState &lexingState, TokenType &tokenType, const char *, int &lineNo)
 {
     if (*textPtr == '=')
     {
         lexingState = LexingState::DONE;
         tokenType = TokenType::NOT_EQUAL;
-        pushAndForward(textPtr, tokenStr);
+        textPtr++;
     }
     else 
     {
@@ -331,11 +767,11 @@ void Lexer::forwardNot(const char *&textPtr, LexingState &lexingState, TokenType
     }
 }
 
-Token Lexer::getNextToken(const char *&textPtr, int &lineNo)
+Token Lexer::getNextToken(const char *text, const char *&textPtr, int &lineNo)
 {
     LexingState lexingState = LexingState::START;
     TokenType tokenType;
-    string tokenStr;
+    const char *tokenBegin = textPtr;
 
     while (true)
     {
@@ -343,52 +779,52 @@ Token Lexer::getNextToken(const char *&textPtr, int &lineNo)
             break;
         }
 
-        // std::cout << tokenStr << "\n";
-
         switch (lexingState)
         {
             case LexingState::START:
-                forwardStart(textPtr, lexingState, tokenType, tokenStr, lineNo);
+                // the last char read in START begins the token
+                tokenBegin = textPtr;
+                forwardStart(textPtr, lexingState, tokenType, tokenBegin, lineNo);
                 break;
 
             case LexingState::IN_ID:
-                forwardId(textPtr, lexingState, tokenType, tokenStr, lineNo);
+                forwardId(textPtr, lexingState, tokenType, tokenBegin, lineNo);
                 break;
 
             case LexingState::IN_LITERAL:
-                forwardLiteral(textPtr, lexingState, tokenType, tokenStr, lineNo);
+                forwardLiteral(textPtr, lexingState, tokenType, tokenBegin, lineNo);
                 break;
 
             case LexingState::IN_SLASH:
-                forwardSlash(textPtr, lexingState, tokenType, tokenStr, lineNo);
+                forwardSlash(textPtr, lexingState, tokenType, tokenBegin, lineNo);
                 break;
 
             case LexingState::IN_SINGLELINE_COMMENT:
-                forwardSinglelineComment(textPtr, lexingState, tokenType, tokenStr, lineNo);
+                forwardSinglelineComment(textPtr, lexingState, tokenType, tokenBegin, lineNo);
                 break;
 
             case LexingState::IN_MULTILINE_COMMENT:
-                forwardMultilineComment(textPtr, lexingState, tokenType, tokenStr, lineNo);
+                forwardMultilineComment(textPtr, lexingState, tokenType, tokenBegin, lineNo);
                 break;
 
             case LexingState::END_MULTILINE_COMMENT:
-                forwardEndMultilineComment(textPtr, lexingState, tokenType, tokenStr, lineNo);
+                forwardEndMultilineComment(textPtr, lexingState, tokenType, tokenBegin, lineNo);
                 break;
 
             case LexingState::IN_LESS:
-                forwardLess(textPtr, lexingState, tokenType, tokenStr, lineNo);
+                forwardLess(textPtr, lexingState, tokenType, tokenBegin, lineNo);
                 break;
 
             case LexingState::IN_GREATER:
-                forwardGreater(textPtr, lexingState, tokenType, tokenStr, lineNo);
+                forwardGreater(textPtr, lexingState, tokenType, tokenBegin, lineNo);
                 break;
 
             case LexingState::IN_EQUAL:
-                forwardEqual(textPtr, lexingState, tokenType, tokenStr, lineNo);
+                forwardEqual(textPtr, lexingState, tokenType, tokenBegin, lineNo);
                 break;
 
             case LexingState::IN_NOT:
-                forwardNot(textPtr, lexingState, tokenType, tokenStr, lineNo);
+                forwardNot(textPtr, lexingState, tokenType, tokenBegin, lineNo);
                 break;
 
             default:
@@ -396,5 +832,5 @@ Token Lexer::getNextToken(const char *&textPtr, int &lineNo)
         }
     }
 
-    return Token(tokenType, tokenStr, lineNo);
+    return makeToken(tokenType, text, tokenBegin, textPtr, lineNo);
 }
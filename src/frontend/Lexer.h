@@ -4,8 +4,10 @@
 #include <string>
 #include <vector>
 #include "LexingState.h"
+#include "SourceBuffer.h"
 #include "Token.h"
 #include "TokenType.h"
+#include "ThreadPool.h"
 
 #define _EOF '\0'
 
@@ -15,64 +17,114 @@ using std::vector;
 class Lexer
 {
 public:
-    Lexer(): readFilePath("") {}
-    Lexer(const string &readFilePath): readFilePath(readFilePath) {}
+    Lexer() = default;
+    Lexer(const string &readFilePath): source(readFilePath) {}
 
+    // tokens refer to getSource(), which lives as long as the lexer
     vector<Token> lexicalAnalysis() const;
 
+    // same tokens as lexicalAnalysis(), by the char by char state machine
+    vector<Token> referenceLexicalAnalysis() const;
+
+    // same tokens as lexicalAnalysis(), chunks of the source lexed by pool
+    vector<Token> parallelLexicalAnalysis(ThreadPool &pool) const;
+
+    // append the next count tokens from textPtr, true once END is
+    bool lexBatch(const char *&textPtr, int &lineNo, size_t count, vector<Token> &tokens) const;
+
+    const SourceBuffer &getSource() const {
+        return source;
+    }
+
 private:
-    string readFilePath;
+    friend class TokenStream;
+
+    SourceBuffer source;
+
+    // fast path of lexicalAnalysis(): table-driven, runs of chars are
+    // scanned by CharScan
+
+    static Token scanToken(const char *text, const char *&textPtr, int &lineNo);
+
+    // textPtr: after "/*", return: after "*/"
+    static const char *skipMultilineComment(const char *textPtr, int &lineNo);
+
+    // IDENTIFIER if not a keyword
+    static TokenType keywordOf(const char *tokenBegin, size_t length);
+
+    static Token makeToken(TokenType tokenType, const char *text,
+                           const char *tokenBegin, const char *tokenEnd, int lineNo);
+
+    // parallelLexicalAnalysis()
+
+    // smallest chunk worth a task
+    static constexpr size_t MIN_CHUNK_BYTES = 1 << 20;
+
+    // tokens of a chunk, lexed as if it started out of any comment, and
+    // again from the next line after an error
+    struct LexedChunk {
+        size_t begin;
+        size_t end;
+        vector<Token> tokens;       // starting in [begin, end), line numbers from 1
+        vector<size_t> errorsAfter; // an error was thrown after tokens[0, i)
+        Token next;                 // first token from end
+        bool failed = false;        // the last error left no line to go on from
+    };
+
+    // chunk bounds, at line starts
+    vector<size_t> splitChunks(size_t chunkCount) const;
+
+    static void lexChunk(const char *text, LexedChunk &chunk);
+
+    // reference state machine
 
     // 非法字符，报错
     static void throwInvalidCharErr(char curChar, int lineNo);
 
-    // token += char, charPtr++;
-    static void pushAndForward(const char *&textPtr, string &tokenStr);
-
     // 开始
     static void forwardStart(const char *&textPtr,
-                             LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &lineNo);
+                             LexingState &lexingState, TokenType &tokenType, const char *tokenBegin, int &lineNo);
 
     // 期望读下一个字
     static void forwardId(const char *&textPtr,
-                          LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &lineNo);
+                          LexingState &lexingState, TokenType &tokenType, const char *tokenBegin, int &lineNo);
 
     // 期望读下一个数
     static void forwardLiteral(const char *&textPtr,
-                              LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &lineNo);
+                              LexingState &lexingState, TokenType &tokenType, const char *tokenBegin, int &lineNo);
 
     // 除号 或者 注释
     static void forwardSlash(const char *&textPtr,
-                             LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &lineNo);
+                             LexingState &lexingState, TokenType &tokenType, const char *tokenBegin, int &lineNo);
 
     // 单行注释，读直到下一行开始
     static void forwardSinglelineComment(const char *&textPtr,
-                                         LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &lineNo);
+                                         LexingState &lexingState, TokenType &tokenType, const char *tokenBegin, int &lineNo);
 
     // 还是多行注释 或者 多行注释要结束 (*)
     static void forwardMultilineComment(const char *&textPtr,
-                                        LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &lineNo);
+                                        LexingState &lexingState, TokenType &tokenType, const char *tokenBegin, int &lineNo);
 
     // 还是多行注释 或者 多行注释要结束 (/)
     static void forwardEndMultilineComment(const char *&textPtr,
-                                           LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &lineNo);
+                                           LexingState &lexingState, TokenType &tokenType, const char *tokenBegin, int &lineNo);
 
     // < 或者 <=
     static void forwardLess(const char *&textPtr,
-                            LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &lineNo);
+                            LexingState &lexingState, TokenType &tokenType, const char *tokenBegin, int &lineNo);
 
     // > 或者 >=
     static void forwardGreater(const char *&textPtr,
-                               LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &lineNo);
+                               LexingState &lexingState, TokenType &tokenType, const char *tokenBegin, int &lineNo);
 
     // = 或者 ==
     static void forwardEqual(const char *&textPtr,
-                              LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &lineNo);
+                              LexingState &lexingState, TokenType &tokenType, const char *tokenBegin, int &lineNo);
 
     // != 或者非法字符
     static void forwardNot(const char *&textPtr,
-                           LexingState &lexingState, TokenType &tokenType, string &tokenStr, int &lineNo);
+                           LexingState &lexingState, TokenType &tokenType, const char *tokenBegin, int &lineNo);
 
-    // 获取下一个 token，循环调用
-    static Token getNextToken(const char *&textPtr, int &lineNo);
+    // 获取下一个 token，循环调用 (text: 源码开头，用于 token 的 offset)
+    static Token getNextToken(const char *text, const char *&textPtr, int &lineNo);
 };
\ No newline at end of file
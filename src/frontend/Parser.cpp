@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <exception>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -12,668 +14,764 @@ using std::vector;
 
 AST *Parser::syntaxAnalysis()
 {
-    AST *root = nullptr;
-    // if (tokenList.empty()) {
-    //     return nullptr;
-    // }
-    auto tokenPtr = tokenList.data();
+    return Program(tokenStream);
+}
 
-    Program(root, tokenPtr);
+/**
+ * @brief Streaming alternative to syntaxAnalysis(), a Decl at a time
+ * @details As DeclList, the source must have one Decl at least.
+ */
+AST *Parser::nextDecl()
+{
+    if (tokenStream->getTokenType() == TokenType::END && tokenStream.getTokenCount() > 0) {
+        return nullptr;
+    }
+    return Decl(tokenStream);
+}
+
+/**
+ * @brief syntaxAnalysis() of tokens lexed beforehand, Decls parsed on pool
+ *
+ * @details declStarts: see findDecls(). Consecutive Decls are parsed in
+ * batches, each by a Parser of its own into a child arena, and their
+ * roots are put in DeclList in source order. onDecl(i, decl) is called on
+ * the thread that parsed the i-th Decl, right after it.
+ * On a syntax error (or a pre-scan that doesn't match the grammar), the
+ * tokens are parsed again by syntaxAnalysis(), which reports the error as
+ * it always does; onDecl is then called in turn, if the Decls were found
+ * by the pre-scan. An error thrown by onDecl is rethrown afterwards, the
+ * first one in source order.
+ */
+AST *Parser::parallelSyntaxAnalysis(const vector<size_t> &declStarts, ThreadPool &pool, const DeclHook &onDecl)
+{
+    const size_t declCount = declStarts.empty() ? 0 : declStarts.size() - 1;
+    const size_t batchCount = std::min<size_t>(declCount, pool.size() * 4);
+
+    vector<AST *> decls(declCount);
+    vector<AstArena *> batchArenas;
+    for (size_t b = 0; b < batchCount; b++) {
+        batchArenas.push_back(&arena.makeChild());
+    }
+    vector<char> syntaxErrors(batchCount, false);
+    vector<std::exception_ptr> hookErrors(batchCount);
+
+    pool.parallelFor(batchCount, [&](size_t b) {
+        const size_t first = declCount * b / batchCount;
+        const size_t last = declCount * (b + 1) / batchCount;
+
+        TokenStream batchTokens = tokenStream.from(declStarts.at(first));
+        Parser parser(batchTokens, *batchArenas.at(b));
+        try {
+            for (size_t i = first; i < last; i++) {
+                decls.at(i) = parser.Decl(batchTokens);
+                if (declStarts.at(first) + batchTokens.getTokenCount() != declStarts.at(i + 1)) {
+                    syntaxErrors.at(b) = true;
+                    return;
+                }
+
+                if (hookErrors.at(b) == nullptr) {
+                    try {
+                        onDecl(i, decls.at(i));
+                    } catch (...) {
+                        hookErrors.at(b) = std::current_exception();
+                    }
+                }
+            }
+        } catch (const std::runtime_error &) {
+            syntaxErrors.at(b) = true;
+        }
+    });
+
+    const bool syntaxError = std::find(syntaxErrors.begin(), syntaxErrors.end(), true) != syntaxErrors.end();
+    if (declCount == 0 || syntaxError) {
+        AST *root = syntaxAnalysis();
+        const auto children = root->getChildren();
+        if (children.size() == declCount) {
+            for (size_t i = 0; i < declCount; i++) {
+                onDecl(i, children[i]);
+            }
+        }
+        return root;
+    }
+    for (const auto &hookError : hookErrors) {
+        if (hookError != nullptr) {
+            std::rethrow_exception(hookError);
+        }
+    }
 
+    // DeclList -> Decl { Decl }
+    AST *root = arena.make(TokenType::DECL_LIST, tokenStream->getLineNo());
+    const int children = arena.beginChildren();
+    for (AST *const decl : decls) {
+        arena.pushChild(decl);
+    }
+    arena.endChildren(root, children);
     return root;
 }
 
-void Parser::throwInvalidTokenErr(const Token *tokenPtr)
+/**
+ * @brief Pre-scan of the tokens of DeclList, lexed beforehand
+ * @details A FuncDecl ends with the '}' matching its first '{', a
+ * VariableDecl with its first ';'. The Decls found are only checked by
+ * parsing them.
+ */
+vector<size_t> Parser::findDecls(const vector<Token> &tokens)
 {
-    const string tokenStr = tokenPtr->getTokenStr();
-    const int lineNo = tokenPtr->getLineNo();
+    // tokens.back() is END
+    auto typeAt = [&tokens](size_t i) {
+        return tokens.at(i).getTokenType();
+    };
+
+    vector<size_t> declStarts;
+    size_t i = 0;
+    while (typeAt(i) != TokenType::END) {
+        declStarts.push_back(i);
+
+        if (i + 2 < tokens.size() && typeAt(i + 2) == TokenType::LEFT_ROUND_BRACKET) {
+            while (typeAt(i) != TokenType::LEFT_CURLY_BRACKET && typeAt(i) != TokenType::END) {
+                i++;
+            }
+            int depth = 0;
+            for (; typeAt(i) != TokenType::END; i++) {
+                if (typeAt(i) == TokenType::LEFT_CURLY_BRACKET) {
+                    depth++;
+                } else if (typeAt(i) == TokenType::RIGHT_CURLY_BRACKET && --depth == 0) {
+                    break;
+                }
+            }
+        } else {
+            while (typeAt(i) != TokenType::SEMICOLON && typeAt(i) != TokenType::END) {
+                i++;
+            }
+        }
+
+        if (typeAt(i) == TokenType::END) {
+            return {};
+        }
+        i++;
+    }
+    declStarts.push_back(i);
+
+    return declStarts;
+}
+
+SymbolId Parser::idOf(const Token &token) const
+{
+    const std::string_view tokenStr = token.getTokenStr(tokenStream.getSource());
+    const auto iter = idCache.find(tokenStr);
+    if (iter != idCache.end()) {
+        return iter->second;
+    }
+
+    const SymbolId id = Interner::global().intern(tokenStr);
+    idCache.emplace(tokenStr, id);
+    return id;
+}
+
+void Parser::throwInvalidTokenErr(const Token &token) const
+{
+    const string tokenStr(token.getTokenStr(tokenStream.getSource()));
+    const int lineNo = token.getLineNo();
     throw std::runtime_error((
         boost::format("Invalid token %s found in line: %d") % tokenStr % lineNo)
     .str());
 }
 
-void Parser::matchToken(TokenType tokenType, Token *&tokenPtr)
+void Parser::matchToken(TokenType tokenType, TokenStream &tokens) const
 {
-    if (tokenPtr->getTokenType() == tokenType)
+    if (tokens->getTokenType() == tokenType)
     {
-        tokenPtr++;
+        tokens.advance();
     }
     else
     {
-        throwInvalidTokenErr(tokenPtr);
+        throwInvalidTokenErr(*tokens);
     }
 }
 
 /**
  * @EBNF Program -> DeclList
  */
-void Parser::Program(AST *&root, Token *&tokenPtr)
+AST *Parser::Program(TokenStream &tokens)
 {
-    DeclList(root, tokenPtr);
+    return DeclList(tokens);
 }
 
 /**
  * @EBNF DeclList -> Decl { Decl }
  */
-void Parser::DeclList(AST *&root, Token *&tokenPtr)
+AST *Parser::DeclList(TokenStream &tokens)
 {
-    std::vector<AST *> children = {nullptr};
-    root = new AST(TokenType::DECL_LIST, "DeclList", children);
-
-    // std::cout << "Before Decl\n";
-
-    Decl(root->getChildren().at(0), tokenPtr);
+    AST *root = arena.make(TokenType::DECL_LIST, tokens->getLineNo());
+    const int children = arena.beginChildren();
 
-    // std::cout << "Before while()\n";
+    arena.pushChild(Decl(tokens));
 
     while (true) {
-        if (tokenPtr->getTokenType() == TokenType::END) {
+        if (tokens->getTokenType() == TokenType::END) {
             break;
         }
-        root->getChildren().push_back(nullptr);
-        
-        // std::cout << "BBefore Decl\n";
-
-        Decl(root->getChildren().back(), tokenPtr);
+        arena.pushChild(Decl(tokens));
     }
+
+    arena.endChildren(root, children);
+    return root;
 }
 
 /**
  * @EBNF Decl -> VarDecl | FunDecl
  */
-void Parser::Decl(AST *&root, Token *&tokenPtr)
+AST *Parser::Decl(TokenStream &tokens)
 {
     // check for first set
-    if (tokenPtr->isTypeToken() == false) {
-        throwInvalidTokenErr(tokenPtr);
+    if (tokens->isTypeToken() == false) {
+        throwInvalidTokenErr(*tokens);
     }
-    // std::cout << "Decl 1\n";
 
     // look one more token
-    TokenType secondTokenType = tokenPtr[1].getTokenType();
+    TokenType secondTokenType = tokens.peek(1).getTokenType();
     if (secondTokenType != TokenType::IDENTIFIER) {
-        throwInvalidTokenErr(tokenPtr + 1);
+        throwInvalidTokenErr(tokens.peek(1));
     }
 
-    // std::cout << "Decl 2\n";
-
     // look two more token
-    TokenType thirdTokenType = tokenPtr[2].getTokenType();
+    TokenType thirdTokenType = tokens.peek(2).getTokenType();
     if (thirdTokenType == TokenType::LEFT_SQUARE_BRACKET || thirdTokenType == TokenType::SEMICOLON) {
-        VariableDecl(root, tokenPtr);
+        return VariableDecl(tokens);
     } else if (thirdTokenType == TokenType::LEFT_ROUND_BRACKET) {
-        FuncDecl(root, tokenPtr);
+        return FuncDecl(tokens);
     } else {
-        throwInvalidTokenErr(tokenPtr + 2);
+        throwInvalidTokenErr(tokens.peek(2));
     }
+    return nullptr;
 }
 
 /**
  * @EBNF VariableDecl -> Type Id [ '[' literal ']' ] ';'
  */
-void Parser::VariableDecl(AST *&root, Token *&tokenPtr)
+AST *Parser::VariableDecl(TokenStream &tokens)
 {
-    std::vector<AST *> children = {nullptr, nullptr};
-    root = new AST(TokenType::VARIABLE_DECL, "VariableDecl", children);
+    AST *root = arena.make(TokenType::VARIABLE_DECL, tokens->getLineNo());
+    const int children = arena.beginChildren();
 
-    Type(root->getChildren().at(0), tokenPtr);
+    arena.pushChild(Type(tokens));
 
-    if (tokenPtr->getTokenType() == TokenType::IDENTIFIER) {
-        root->getChildren().at(1) = new AST(tokenPtr);
-        matchToken(TokenType::IDENTIFIER, tokenPtr);
+    if (tokens->getTokenType() == TokenType::IDENTIFIER) {
+        arena.pushChild(arena.make(*tokens, idOf(*tokens)));
+        matchToken(TokenType::IDENTIFIER, tokens);
     } else {
-        throwInvalidTokenErr(tokenPtr);
+        throwInvalidTokenErr(*tokens);
     }
-    if (tokenPtr->getTokenType() == TokenType::LEFT_SQUARE_BRACKET) {
-        matchToken(TokenType::LEFT_SQUARE_BRACKET, tokenPtr);
+    if (tokens->getTokenType() == TokenType::LEFT_SQUARE_BRACKET) {
+        matchToken(TokenType::LEFT_SQUARE_BRACKET, tokens);
 
-        root->getChildren().push_back(new AST(tokenPtr));
+        arena.pushChild(arena.make(*tokens, idOf(*tokens)));
 
-        matchToken(TokenType::LITERAL, tokenPtr);
-        matchToken(TokenType::RIGHT_SQUARE_BRACKET, tokenPtr);
+        matchToken(TokenType::LITERAL, tokens);
+        matchToken(TokenType::RIGHT_SQUARE_BRACKET, tokens);
     }
-    matchToken(TokenType::SEMICOLON, tokenPtr);
+    matchToken(TokenType::SEMICOLON, tokens);
+
+    arena.endChildren(root, children);
+    return root;
 }
 
 /**
  * @EBNF Type -> int | void
  */
-void Parser::Type(AST *&root, Token *&tokenPtr) 
+AST *Parser::Type(TokenStream &tokens)
 {
-    if (tokenPtr->isTypeToken()) {
-        root = new AST(tokenPtr);
-        matchToken(tokenPtr->getTokenType(), tokenPtr);
-    } else {
-        throwInvalidTokenErr(tokenPtr);
+    if (tokens->isTypeToken() == false) {
+        throwInvalidTokenErr(*tokens);
     }
+    AST *root = arena.make(*tokens, idOf(*tokens));
+    matchToken(tokens->getTokenType(), tokens);
+    return root;
 }
 
 /**
  * @EBNF FuncDecl -> Type id '(' Params ')' CompoundStmt
  */
-void Parser::FuncDecl(AST *&root, Token *&tokenPtr) 
+AST *Parser::FuncDecl(TokenStream &tokens)
 {
-    std::vector<AST *> children = {nullptr, nullptr, nullptr, nullptr};
-    root = new AST(TokenType::FUNC_DECL, "FuncDecl", children);
+    AST *root = arena.make(TokenType::FUNC_DECL, tokens->getLineNo());
+    const int children = arena.beginChildren();
 
-    // std::cout << "FuncDecl\n";
-    
-    Type(root->getChildren().at(0), tokenPtr);
+    arena.pushChild(Type(tokens));
 
-    // std::cout << "After Type\n";
+    if (tokens->getTokenType() == TokenType::IDENTIFIER) {
+        arena.pushChild(arena.make(*tokens, idOf(*tokens)));
 
-    if (tokenPtr->getTokenType() == TokenType::IDENTIFIER) {
-        root->getChildren().at(1) = new AST(tokenPtr);
-        
-        matchToken(TokenType::IDENTIFIER, tokenPtr);
+        matchToken(TokenType::IDENTIFIER, tokens);
     } else {
-        throwInvalidTokenErr(tokenPtr);
+        throwInvalidTokenErr(*tokens);
     }
 
-    // std::cout << "C1\n";
+    matchToken(TokenType::LEFT_ROUND_BRACKET, tokens);
+    arena.pushChild(Params(tokens));
 
-    matchToken(TokenType::LEFT_ROUND_BRACKET, tokenPtr);
-    Params(root->getChildren().at(2), tokenPtr);
+    matchToken(TokenType::RIGHT_ROUND_BRACKET, tokens);
+    arena.pushChild(CompoundStmt(tokens));
 
-    // std::cout << "Param\n";
-
-    matchToken(TokenType::RIGHT_ROUND_BRACKET, tokenPtr);
-    CompoundStmt(root->getChildren().at(3), tokenPtr);
+    arena.endChildren(root, children);
+    return root;
 }
 
 /**
  * @EBNF Params -> [ParamList]
  */
-void Parser::Params(AST *&root, Token *&tokenPtr) 
+AST *Parser::Params(TokenStream &tokens)
 {
-    if (tokenPtr->isTypeToken()) {
-        ParamList(root, tokenPtr);
+    if (tokens->isTypeToken()) {
+        return ParamList(tokens);
     }
+    return nullptr;
 }
 
 /**
  * @EBNF ParamList -> Param { ',' Param }
  */
-void Parser::ParamList(AST *&root, Token *&tokenPtr) 
+AST *Parser::ParamList(TokenStream &tokens)
 {
-    std::vector<AST *> children = {nullptr};
-    root = new AST(TokenType::PARAM_LIST, "ParamList", children);
+    AST *root = arena.make(TokenType::PARAM_LIST, tokens->getLineNo());
+    const int children = arena.beginChildren();
 
-    Param(root->getChildren().at(0), tokenPtr);
+    arena.pushChild(Param(tokens));
     while (true) {
-        if (tokenPtr->getTokenType() != TokenType::COMMA) {
+        if (tokens->getTokenType() != TokenType::COMMA) {
             break;
         }
-        matchToken(TokenType::COMMA, tokenPtr);
+        matchToken(TokenType::COMMA, tokens);
 
-        root->getChildren().push_back(nullptr);
-        Param(root->getChildren().back(), tokenPtr);
+        arena.pushChild(Param(tokens));
     }
+
+    arena.endChildren(root, children);
+    return root;
 }
 
 /**
  * @EBNF Param -> Type id [ '[' ']' ]
  */
-void Parser::Param(AST *&root, Token *&tokenPtr) 
+AST *Parser::Param(TokenStream &tokens)
 {
-    std::vector<AST *> children = {nullptr, nullptr};
-    root = new AST(TokenType::PARAM, "Param", children);
-    Type(root->getChildren().at(0), tokenPtr);
+    AST *root = arena.make(TokenType::PARAM, tokens->getLineNo());
+    const int children = arena.beginChildren();
 
-    if (tokenPtr->getTokenType() == TokenType::IDENTIFIER) {
-        root->getChildren().at(1) = new AST(tokenPtr);
-        matchToken(TokenType::IDENTIFIER, tokenPtr);
+    arena.pushChild(Type(tokens));
+
+    if (tokens->getTokenType() == TokenType::IDENTIFIER) {
+        arena.pushChild(arena.make(*tokens, idOf(*tokens)));
+        matchToken(TokenType::IDENTIFIER, tokens);
     } else {
-        throwInvalidTokenErr(tokenPtr);
+        throwInvalidTokenErr(*tokens);
     }
-    
-    // has [] 
-    if (tokenPtr->getTokenType() == TokenType::LEFT_SQUARE_BRACKET) {
-        matchToken(TokenType::LEFT_SQUARE_BRACKET, tokenPtr);
-        matchToken(TokenType::RIGHT_SQUARE_BRACKET, tokenPtr);
+
+    // has []
+    if (tokens->getTokenType() == TokenType::LEFT_SQUARE_BRACKET) {
+        matchToken(TokenType::LEFT_SQUARE_BRACKET, tokens);
+        matchToken(TokenType::RIGHT_SQUARE_BRACKET, tokens);
     }
+
+    arena.endChildren(root, children);
+    return root;
 }
 
 /**
  * @EBNF CompoundStmt -> '{' LocalVariableDecl StmtList '}'
- * 
- * @details Note that local variable declaration is only 
- * allowed in the beginning of a CompoundStmt. In early JS, 
+ *
+ * @details Note that local variable declaration is only
+ * allowed in the beginning of a CompoundStmt. In early JS,
  * varaible hoisting is implemented because of the similar reason.
  */
-void Parser::CompoundStmt(AST *&root, Token *&tokenPtr) 
+AST *Parser::CompoundStmt(TokenStream &tokens)
 {
-    std::vector<AST *> children = {nullptr, nullptr};
-    root = new AST(TokenType::COMPOUND_STMT, "CompoundStmt", children);
+    AST *root = arena.make(TokenType::COMPOUND_STMT, tokens->getLineNo());
+    const int children = arena.beginChildren();
 
-    matchToken(TokenType::LEFT_CURLY_BRACKET, tokenPtr);
+    matchToken(TokenType::LEFT_CURLY_BRACKET, tokens);
 
-    LocalVariableDecl(root->getChildren().at(0), tokenPtr);
+    arena.pushChild(LocalVariableDecl(tokens));
 
-    // std::cout << "CS\n";
+    arena.pushChild(StmtList(tokens));
 
-    StmtList(root->getChildren().at(1), tokenPtr);
+    matchToken(TokenType::RIGHT_CURLY_BRACKET, tokens);
 
-    matchToken(TokenType::RIGHT_CURLY_BRACKET, tokenPtr);
+    arena.endChildren(root, children);
+    return root;
 }
 
 /**
  * @EBNF LocalVariableDecl -> { VariableDecl }
  */
-void Parser::LocalVariableDecl(AST *&root, Token *&tokenPtr) 
+AST *Parser::LocalVariableDecl(TokenStream &tokens)
 {
-    root = new AST(TokenType::LOCAL_VARIABLE_DECL, "LocalVariableDecl");
+    AST *root = arena.make(TokenType::LOCAL_VARIABLE_DECL, tokens->getLineNo());
+    const int children = arena.beginChildren();
 
-    while (tokenPtr->isTypeToken()) {
-        root->getChildren().push_back(nullptr);
-        VariableDecl(root->getChildren().back(), tokenPtr);
+    while (tokens->isTypeToken()) {
+        arena.pushChild(VariableDecl(tokens));
     }
+
+    arena.endChildren(root, children);
+    return root;
 }
 
 /**
  * @EBNF StmtList -> { Stmt }
  */
-void Parser::StmtList(AST *&root, Token *&tokenPtr) 
+AST *Parser::StmtList(TokenStream &tokens)
 {
-    root = new AST(TokenType::STMT_LIST, "StmtList");
+    AST *root = arena.make(TokenType::STMT_LIST, tokens->getLineNo());
+    const int children = arena.beginChildren();
 
     while (true) {
         // first set
-        if ((tokenPtr->getTokenType() == TokenType::SEMICOLON ||
-            tokenPtr->getTokenType() == TokenType::IDENTIFIER ||
-            tokenPtr->getTokenType() == TokenType::LEFT_ROUND_BRACKET ||
-            tokenPtr->getTokenType() == TokenType::LITERAL ||
-            tokenPtr->getTokenType() == TokenType::LEFT_CURLY_BRACKET ||
-            tokenPtr->getTokenType() == TokenType::IF ||
-            tokenPtr->getTokenType() == TokenType::WHILE ||
-            tokenPtr->getTokenType() == TokenType::RETURN) == false
+        if ((tokens->getTokenType() == TokenType::SEMICOLON ||
+            tokens->getTokenType() == TokenType::IDENTIFIER ||
+            tokens->getTokenType() == TokenType::LEFT_ROUND_BRACKET ||
+            tokens->getTokenType() == TokenType::LITERAL ||
+            tokens->getTokenType() == TokenType::LEFT_CURLY_BRACKET ||
+            tokens->getTokenType() == TokenType::IF ||
+            tokens->getTokenType() == TokenType::WHILE ||
+            tokens->getTokenType() == TokenType::RETURN) == false
         ) {
             break;
         }
 
-        // std::cout << "StmtList\n";
-
-        root->getChildren().push_back(nullptr);
-        Stmt(root->getChildren().back(), tokenPtr);
+        arena.pushChild(Stmt(tokens));
     }
+
+    arena.endChildren(root, children);
+    return root;
 }
 
 /**
  * @EBNF Stmt -> ExprStmt | CompoundStmt | IfStmt | WhileStmt | ReturnStmt
  */
-void Parser::Stmt(AST *&root, Token *&tokenPtr) 
+AST *Parser::Stmt(TokenStream &tokens)
 {
-    // std::cout << "TestStmt\n";
     // first set
-    if (tokenPtr->getTokenType() == TokenType::SEMICOLON ||
-        tokenPtr->getTokenType() == TokenType::IDENTIFIER ||
-        tokenPtr->getTokenType() == TokenType::LEFT_ROUND_BRACKET ||
-        tokenPtr->getTokenType() == TokenType::LITERAL
+    if (tokens->getTokenType() == TokenType::SEMICOLON ||
+        tokens->getTokenType() == TokenType::IDENTIFIER ||
+        tokens->getTokenType() == TokenType::LEFT_ROUND_BRACKET ||
+        tokens->getTokenType() == TokenType::LITERAL
     ) {
-        ExprStmt(root, tokenPtr);
-    } else if (tokenPtr->getTokenType() == TokenType::LEFT_CURLY_BRACKET) {
-        CompoundStmt(root, tokenPtr);
-    } else if (tokenPtr->getTokenType() == TokenType::IF) {
-        IfStmt(root, tokenPtr);
-    } else if (tokenPtr->getTokenType() == TokenType::WHILE) {
-        WhileStmt(root, tokenPtr);
-    } else if (tokenPtr->getTokenType() == TokenType::RETURN) {
-        ReturnStmt(root, tokenPtr);
+        return ExprStmt(tokens);
+    } else if (tokens->getTokenType() == TokenType::LEFT_CURLY_BRACKET) {
+        return CompoundStmt(tokens);
+    } else if (tokens->getTokenType() == TokenType::IF) {
+        return IfStmt(tokens);
+    } else if (tokens->getTokenType() == TokenType::WHILE) {
+        return WhileStmt(tokens);
+    } else if (tokens->getTokenType() == TokenType::RETURN) {
+        return ReturnStmt(tokens);
     } else {
-        throwInvalidTokenErr(tokenPtr);
+        throwInvalidTokenErr(*tokens);
     }
+    return nullptr;
 }
 
 /**
  * @EBNF ExprStmt -> [ Expr ] ';'
+ * @return nullptr for an empty statement
  */
-void Parser::ExprStmt(AST *&root, Token *&tokenPtr) 
+AST *Parser::ExprStmt(TokenStream &tokens)
 {
+    AST *root = nullptr;
+
     // match expr (first set)
-    if (tokenPtr->getTokenType() == TokenType::IDENTIFIER ||
-        tokenPtr->getTokenType() == TokenType::LEFT_ROUND_BRACKET ||
-        tokenPtr->getTokenType() == TokenType::LITERAL
+    if (tokens->getTokenType() == TokenType::IDENTIFIER ||
+        tokens->getTokenType() == TokenType::LEFT_ROUND_BRACKET ||
+        tokens->getTokenType() == TokenType::LITERAL
     ) {
-        Expr(root, tokenPtr);
+        root = Expr(tokens);
     }
 
-    matchToken(TokenType::SEMICOLON, tokenPtr);
+    matchToken(TokenType::SEMICOLON, tokens);
+    return root;
 }
 
 /**
  * @EBNF IfStmt -> if '(' Expr ')' Stmt [ else Stmt ]
- * 
+ *
  * @details dangling else.
  */
-void Parser::IfStmt(AST *&root, Token *&tokenPtr) 
+AST *Parser::IfStmt(TokenStream &tokens)
 {
-    std::vector<AST *> children = {nullptr, nullptr};
-    root = new AST(TokenType::IF_STMT, "IfStmt", children);
+    AST *root = arena.make(TokenType::IF_STMT, tokens->getLineNo());
+    const int children = arena.beginChildren();
 
-    matchToken(TokenType::IF, tokenPtr);
-    matchToken(TokenType::LEFT_ROUND_BRACKET, tokenPtr);
+    matchToken(TokenType::IF, tokens);
+    matchToken(TokenType::LEFT_ROUND_BRACKET, tokens);
 
-    // std::cout << "if stmt\n";
+    arena.pushChild(Expr(tokens));
 
-    Expr(root->getChildren().at(0), tokenPtr);
+    matchToken(TokenType::RIGHT_ROUND_BRACKET, tokens);
 
-    // std::cout << "after expr\n";
+    arena.pushChild(Stmt(tokens));
 
-    matchToken(TokenType::RIGHT_ROUND_BRACKET, tokenPtr);
+    if (tokens->getTokenType() == TokenType::ELSE) {
+        matchToken(TokenType::ELSE, tokens);
 
-    Stmt(root->getChildren().at(1), tokenPtr);
-
-    // std::cout << "after Stmt\n";
-
-    if (tokenPtr->getTokenType() == TokenType::ELSE) {
-        matchToken(TokenType::ELSE, tokenPtr);
-
-        root->getChildren().push_back(nullptr);
-        Stmt(root->getChildren().at(2), tokenPtr);
-        // std::cout << "after Stmt2\n";
+        arena.pushChild(Stmt(tokens));
     }
+
+    arena.endChildren(root, children);
+    return root;
 }
 
 /**
  * @EBNF WhileStmt -> while '(' Expr ')' Stmt
  */
-void Parser::WhileStmt(AST *&root, Token *&tokenPtr) 
+AST *Parser::WhileStmt(TokenStream &tokens)
 {
-    // std::cout << "While DEBUG\n";
+    AST *root = arena.make(TokenType::WHILE_STMT, tokens->getLineNo());
+    const int children = arena.beginChildren();
 
-    std::vector<AST *> children = {nullptr, nullptr};
-    root = new AST(TokenType::WHILE_STMT, "WhileStmt", children);
+    matchToken(TokenType::WHILE, tokens);
+    matchToken(TokenType::LEFT_ROUND_BRACKET, tokens);
 
-    matchToken(TokenType::WHILE, tokenPtr);
-    matchToken(TokenType::LEFT_ROUND_BRACKET, tokenPtr);
+    arena.pushChild(Expr(tokens));
 
-    Expr(root->getChildren().at(0), tokenPtr);
+    matchToken(TokenType::RIGHT_ROUND_BRACKET, tokens);
 
-    matchToken(TokenType::RIGHT_ROUND_BRACKET, tokenPtr);
+    arena.pushChild(Stmt(tokens));
 
-    Stmt(root->getChildren().at(1), tokenPtr);
+    arena.endChildren(root, children);
+    return root;
 }
 
 /**
  * @EBNF ReturnStmt -> return [ Expr ] ';'
  */
-void Parser::ReturnStmt(AST *&root, Token *&tokenPtr) 
+AST *Parser::ReturnStmt(TokenStream &tokens)
 {
-    root = new AST(TokenType::RETURN_STMT, "ReturnStmt");
-    matchToken(TokenType::RETURN, tokenPtr);
+    AST *root = arena.make(TokenType::RETURN_STMT, tokens->getLineNo());
+    const int children = arena.beginChildren();
+
+    matchToken(TokenType::RETURN, tokens);
 
     // match expr (first set)
-    if (tokenPtr->getTokenType() == TokenType::IDENTIFIER ||
-        tokenPtr->getTokenType() == TokenType::LEFT_ROUND_BRACKET ||
-        tokenPtr->getTokenType() == TokenType::LITERAL
+    if (tokens->getTokenType() == TokenType::IDENTIFIER ||
+        tokens->getTokenType() == TokenType::LEFT_ROUND_BRACKET ||
+        tokens->getTokenType() == TokenType::LITERAL
     ) {
-        root->getChildren().push_back(nullptr);
-        Expr(root->getChildren().back(), tokenPtr);
+        arena.pushChild(Expr(tokens));
     }
 
-    matchToken(TokenType::SEMICOLON, tokenPtr);
+    matchToken(TokenType::SEMICOLON, tokens);
+
+    arena.endChildren(root, children);
+    return root;
 }
 
 /**
  * @EBNF Expr -> SimpleExpr | Variable '=' Expr
- * 
+ *
  * @details Expr is SimpleExpr or AssignmentExpr
  * conflict: First(SimpleExpr) ∩ First(Variable) == { id }
- * which is resolved by looking Variable.
+ * which is resolved by looking Variable. If no '=' follows it,
+ * the Variable is the first operand of a SimpleExpr.
  */
-void Parser::Expr(AST *&root, Token *&tokenPtr) 
+AST *Parser::Expr(TokenStream &tokens)
 {
-    std::vector<AST *> children = {nullptr};
-    root = new AST(TokenType::EXPR, "Expr", children);
-
-    // start with parenthesis or literal
-    // must be SimpleExpr / SimpleExpr
-    if (tokenPtr->getTokenType() == TokenType::LEFT_ROUND_BRACKET ||
-        tokenPtr->getTokenType() == TokenType::LITERAL
+    // start with parenthesis, literal or function call
+    // must be SimpleExpr
+    if (tokens->getTokenType() != TokenType::IDENTIFIER ||
+        tokens.peek(1).getTokenType() == TokenType::LEFT_ROUND_BRACKET
     ) {
-        SimpleExpr(root->getChildren().at(0), tokenPtr);
-        return;
+        return BinaryExpr(Factor(tokens), 0, tokens);
     }
 
-    if (tokenPtr->getTokenType() == TokenType::IDENTIFIER) {
-        // look one more
-        // Function call, derive SimpleExpr
-        if (tokenPtr[1].getTokenType() == TokenType::LEFT_ROUND_BRACKET) {
-            SimpleExpr(root->getChildren().at(0), tokenPtr);
-        } else {
-            Token *tmpTokenPtr = tokenPtr;
-
-            Variable(root->getChildren().at(0), tokenPtr);
-
-            // std::cout << "After Variable\n";
-
-            bool isAssignOp = tokenPtr->getTokenType() == TokenType::ASSIGN;
-            AST::destroyChildrenRecursively(root);
-            // backtrack
-            tokenPtr = tmpTokenPtr;
+    AST *variable = Variable(tokens);
+    if (tokens->getTokenType() != TokenType::ASSIGN) {
+        return BinaryExpr(variable, 0, tokens);
+    }
 
-            if (isAssignOp) {
-                root->getChildren().push_back(nullptr);
-                Variable(root->getChildren().at(0), tokenPtr);
-                matchToken(TokenType::ASSIGN, tokenPtr);
+    AST *root = arena.make(*tokens, idOf(*tokens), variable->getLineNo());
+    const int children = arena.beginChildren();
 
-                Expr(root->getChildren().at(1), tokenPtr);
-            } else {
-                // std::cout << "SimpleExpr\n";
+    matchToken(TokenType::ASSIGN, tokens);
+    arena.pushChild(variable);
+    arena.pushChild(Expr(tokens));
 
-                SimpleExpr(root->getChildren().at(0), tokenPtr);
-            }
-        }
-    } else {
-        throwInvalidTokenErr(tokenPtr);
-    }
+    arena.endChildren(root, children);
+    return root;
 }
 
 /**
  * @EBNF Variable -> id [ '[' Expr ']' ]
- * 
+ *
  * @details support dereference for array variable.
  */
-void Parser::Variable(AST *&root, Token *&tokenPtr) 
+AST *Parser::Variable(TokenStream &tokens)
 {
-    std::vector<AST *> children = {nullptr};
-    root = new AST(TokenType::VARIABLE, "Variable", children); 
+    AST *root = arena.make(TokenType::VARIABLE, tokens->getLineNo());
+    const int children = arena.beginChildren();
 
-    if (tokenPtr->getTokenType() == TokenType::IDENTIFIER) {
-        root->getChildren().at(0) = new AST(tokenPtr);
-        matchToken(TokenType::IDENTIFIER, tokenPtr);
+    if (tokens->getTokenType() == TokenType::IDENTIFIER) {
+        arena.pushChild(arena.make(*tokens, idOf(*tokens)));
+        matchToken(TokenType::IDENTIFIER, tokens);
     } else {
-        throwInvalidTokenErr(tokenPtr);
+        throwInvalidTokenErr(*tokens);
     }
 
     // array index
-    if (tokenPtr->getTokenType() == TokenType::LEFT_SQUARE_BRACKET) {
-        matchToken(TokenType::LEFT_SQUARE_BRACKET, tokenPtr);
+    if (tokens->getTokenType() == TokenType::LEFT_SQUARE_BRACKET) {
+        matchToken(TokenType::LEFT_SQUARE_BRACKET, tokens);
 
-        root->getChildren().push_back(nullptr);
-        Expr(root->getChildren().at(1), tokenPtr);
+        arena.pushChild(Expr(tokens));
 
-        matchToken(TokenType::RIGHT_SQUARE_BRACKET, tokenPtr);
+        matchToken(TokenType::RIGHT_SQUARE_BRACKET, tokens);
     }
-}
 
-/**
- * @EBNF SimpleExpr -> AddExpr [ RelationOp AddExpr ]
- * 
- * @details RelationOp is nullable
- */
-void Parser::SimpleExpr(AST *&root, Token *&tokenPtr) 
-{
-    std::vector<AST *> children = {nullptr};
-    root = new AST(TokenType::SIMPLE_EXPR, "SimpleExpr", children);
-
-    AddExpr(root->getChildren().at(0), tokenPtr);
-
-    if (tokenPtr->isRelationOpToken()) {
-        root->getChildren().push_back(nullptr);
-        RelationOp(root->getChildren().at(1), tokenPtr);
-
-        root->getChildren().push_back(nullptr);
-        AddExpr(root->getChildren().at(2), tokenPtr);
-    }
+    arena.endChildren(root, children);
+    return root;
 }
 
 /**
+ * @EBNF SimpleExpr -> AddExpr [ RelationOp AddExpr ]
  * @EBNF RelationOp -> < | <= | > | >= | == | !=
- */
-void Parser::RelationOp(AST *&root, Token *&tokenPtr) 
-{
-    if (tokenPtr->isRelationOpToken()) {
-        root = new AST(tokenPtr);
-        matchToken(tokenPtr->getTokenType(), tokenPtr);
-    } else {
-        throwInvalidTokenErr(tokenPtr);
-    }
-}
-
-/**
  * @EBNF AddExpr -> Term { AddOp Term }
+ * @EBNF AddOp -> + | -
+ * @EBNF Term -> Factor { MulOp Factor }
+ * @EBNF MulOp -> * | /
+ *
+ * @details Precedence climbing: lhs is the first operand, every
+ * operator of at least minPrecedence is folded into it (left
+ * associative). RelationOp is not associative, so `a < b < c` stops
+ * at the second '<', which the caller rejects.
  */
-void Parser::AddExpr(AST *&root, Token *&tokenPtr) 
+AST *Parser::BinaryExpr(AST *lhs, int minPrecedence, TokenStream &tokens)
 {
-    std::vector<AST *> children = {nullptr};
-    root = new AST(TokenType::ADD_EXPR, "AddExpr", children);
-
-    Term(root->getChildren().at(0), tokenPtr);
-
     while (true) {
-        if (tokenPtr->getTokenType() != TokenType::PLUS && tokenPtr->getTokenType() != TokenType::MINUS) {
+        const int precedence = precedenceOf(tokens->getTokenType());
+        if (precedence == 0 || precedence < minPrecedence) {
             break;
         }
 
-        root->getChildren().push_back(nullptr);
-        AddOp(root->getChildren().back(), tokenPtr);
-
-        root->getChildren().push_back(nullptr);
-        Term(root->getChildren().back(), tokenPtr);
-    }
-}
-
-/**
- * @EBNF AddOp -> + | -
- */
-void Parser::AddOp(AST *&root, Token *&tokenPtr) 
-{
-    if (tokenPtr->getTokenType() == TokenType::PLUS || tokenPtr->getTokenType() == TokenType::MINUS) {
-        root = new AST(tokenPtr);
-        matchToken(tokenPtr->getTokenType(), tokenPtr);
-    } else {
-        throwInvalidTokenErr(tokenPtr);
-    }
-}
-
-/**
- * @EBNF Term -> Factor { MulOp Factor }
- */
-void Parser::Term(AST *&root, Token *&tokenPtr) 
-{
-    std::vector<AST *> children = {nullptr};
-    root = new AST(TokenType::TERM, "Term", children);
+        // the operator node is on the line of its first operand
+        AST *root = arena.make(*tokens, idOf(*tokens), lhs->getLineNo());
+        const int children = arena.beginChildren();
+        matchToken(tokens->getTokenType(), tokens);
 
-    Factor(root->getChildren().at(0), tokenPtr);
+        arena.pushChild(lhs);
+        arena.pushChild(BinaryExpr(Factor(tokens), precedence + 1, tokens));
+        arena.endChildren(root, children);
 
-    while (true) {
-        if (tokenPtr->getTokenType() != TokenType::MULTIPLY && tokenPtr->getTokenType() != TokenType::DIVIDE) {
+        lhs = root;
+        if (precedence == 1) {
             break;
         }
-
-        root->getChildren().push_back(nullptr);
-        MulOp(root->getChildren().back(), tokenPtr);
-
-        root->getChildren().push_back(nullptr);
-        Factor(root->getChildren().back(), tokenPtr);
     }
+    return lhs;
 }
 
 /**
- * @EBNF MulOp -> * | /
+ * @return 0 if not a binary operator, RelationOp 1, AddOp 2, MulOp 3
  */
-void Parser::MulOp(AST *&root, Token *&tokenPtr) 
+int Parser::precedenceOf(TokenType tokenType)
 {
-    if (tokenPtr->getTokenType() == TokenType::MULTIPLY || tokenPtr->getTokenType() == TokenType::DIVIDE) {
-        root = new AST(tokenPtr);
-        matchToken(tokenPtr->getTokenType(), tokenPtr);
-    } else {
-        throwInvalidTokenErr(tokenPtr);
+    switch (tokenType) {
+        case TokenType::LESS:
+        case TokenType::LESS_EQUAL:
+        case TokenType::GREATER:
+        case TokenType::GREATER_EQUAL:
+        case TokenType::EQUAL:
+        case TokenType::NOT_EQUAL:
+            return 1;
+        case TokenType::PLUS:
+        case TokenType::MINUS:
+            return 2;
+        case TokenType::MULTIPLY:
+        case TokenType::DIVIDE:
+            return 3;
+        default:
+            return 0;
     }
 }
 
 /**
  * @EBNF Factor -> '(' Expr ')' | Variable | Call | literal
+ * @details '(' Expr ')' gives the node of Expr
  */
-void Parser::Factor(AST *&root, Token *&tokenPtr) 
+AST *Parser::Factor(TokenStream &tokens)
 {
-    if (tokenPtr->getTokenType() == TokenType::LEFT_ROUND_BRACKET) {
-        matchToken(TokenType::LEFT_ROUND_BRACKET, tokenPtr);
+    AST *root = nullptr;
 
-        Expr(root, tokenPtr);
+    if (tokens->getTokenType() == TokenType::LEFT_ROUND_BRACKET) {
+        matchToken(TokenType::LEFT_ROUND_BRACKET, tokens);
 
-        matchToken(TokenType::RIGHT_ROUND_BRACKET, tokenPtr);
-    } else if (tokenPtr->getTokenType() == TokenType::LITERAL) {
-        root = new AST(tokenPtr);
+        root = Expr(tokens);
 
-        matchToken(tokenPtr->getTokenType(), tokenPtr);
-    } else if (tokenPtr->getTokenType() == TokenType::IDENTIFIER) {
-        if (tokenPtr[1].getTokenType() == TokenType::LEFT_ROUND_BRACKET) {
-            Call(root, tokenPtr);
+        matchToken(TokenType::RIGHT_ROUND_BRACKET, tokens);
+    } else if (tokens->getTokenType() == TokenType::LITERAL) {
+        root = arena.make(*tokens, idOf(*tokens));
+
+        matchToken(tokens->getTokenType(), tokens);
+    } else if (tokens->getTokenType() == TokenType::IDENTIFIER) {
+        if (tokens.peek(1).getTokenType() == TokenType::LEFT_ROUND_BRACKET) {
+            root = Call(tokens);
         } else {
-            Variable(root, tokenPtr);
+            root = Variable(tokens);
         }
     } else {
-        throwInvalidTokenErr(tokenPtr);
+        throwInvalidTokenErr(*tokens);
     }
+
+    return root;
 }
 
 /**
  * @EBNF Call -> id '(' [ ArgList ] ')'
  */
-void Parser::Call(AST *&root, Token *&tokenPtr) 
+AST *Parser::Call(TokenStream &tokens)
 {
-    std::vector<AST *> children = {nullptr};
-    root = new AST(TokenType::CALL, "Call", children);
+    AST *root = arena.make(TokenType::CALL, tokens->getLineNo());
+    const int children = arena.beginChildren();
 
-    if (tokenPtr->getTokenType() == TokenType::IDENTIFIER) {
-        root->getChildren().at(0) = new AST(tokenPtr);
-        matchToken(TokenType::IDENTIFIER, tokenPtr);
+    if (tokens->getTokenType() == TokenType::IDENTIFIER) {
+        arena.pushChild(arena.make(*tokens, idOf(*tokens)));
+        matchToken(TokenType::IDENTIFIER, tokens);
     } else {
-        throwInvalidTokenErr(tokenPtr);
+        throwInvalidTokenErr(*tokens);
     }
 
-    matchToken(TokenType::LEFT_ROUND_BRACKET, tokenPtr);
+    matchToken(TokenType::LEFT_ROUND_BRACKET, tokens);
 
-    if (tokenPtr->getTokenType() == TokenType::IDENTIFIER         ||
-        tokenPtr->getTokenType() == TokenType::LEFT_ROUND_BRACKET ||
-        tokenPtr->getTokenType() == TokenType::LITERAL
+    if (tokens->getTokenType() == TokenType::IDENTIFIER         ||
+        tokens->getTokenType() == TokenType::LEFT_ROUND_BRACKET ||
+        tokens->getTokenType() == TokenType::LITERAL
     ) {
-        root->getChildren().push_back(nullptr);
-        ArgList(root->getChildren().at(1), tokenPtr);
+        arena.pushChild(ArgList(tokens));
     }
 
-    matchToken(TokenType::RIGHT_ROUND_BRACKET, tokenPtr);
+    matchToken(TokenType::RIGHT_ROUND_BRACKET, tokens);
+
+    arena.endChildren(root, children);
+    return root;
 }
 
 /**
  * @EBNF ArgList -> Expr { ',' Expr }
  */
-void Parser::ArgList(AST *&root, Token *&tokenPtr) 
+AST *Parser::ArgList(TokenStream &tokens)
 {
-    std::vector<AST *> children = {nullptr};
-    root = new AST(TokenType::ARG_LIST, "ArgList", children);
+    AST *root = arena.make(TokenType::ARG_LIST, tokens->getLineNo());
+    const int children = arena.beginChildren();
 
-    Expr(root->getChildren().at(0), tokenPtr);
+    arena.pushChild(Expr(tokens));
 
     while (true) {
-        if (tokenPtr->getTokenType() != TokenType::COMMA) {
+        if (tokens->getTokenType() != TokenType::COMMA) {
             break;
         }
-        matchToken(TokenType::COMMA, tokenPtr);
+        matchToken(TokenType::COMMA, tokens);
 
-        root->getChildren().push_back(nullptr);
-        Expr(root->getChildren().back(), tokenPtr);
+        arena.pushChild(Expr(tokens));
     }
-}
\ No newline at end of file
+
+    arena.endChildren(root, children);
+    return root;
+}
@@ -1,7 +1,14 @@
 #pragma once
 
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 #include "AST.h"
+#include "AstArena.h"
+#include "ThreadPool.h"
 #include "Token.h"
+#include "TokenStream.h"
 
 /**
  * @brief recursive descent LL(*) parser constructed manually by EBNF
@@ -11,76 +18,89 @@
 class Parser
 {
 public:
-    Parser() : tokenList(vector<Token>()) {}
-    Parser(const vector<Token> &tokenList) : tokenList(tokenList) {}
+    // tokens are pulled from tokenStream while parsing. Nodes are
+    // allocated in arena, which owns the AST
+    Parser(TokenStream &tokenStream, AstArena &arena): tokenStream(tokenStream), arena(arena) {}
 
     // return root of AST
     AST *syntaxAnalysis();
 
-private:
-    vector<Token> tokenList;
+    // parse the next Decl of DeclList only, nullptr after the last one
+    AST *nextDecl();
 
-    static void throwInvalidTokenErr(const Token *tokenPtr);
+    // called with the index in DeclList of each Decl, once it's parsed
+    using DeclHook = std::function<void(size_t declIndex, AST *decl)>;
 
-    static void matchToken(TokenType tokenType, Token *&tokenPtr);
+    // syntaxAnalysis() of tokens lexed beforehand, Decls on pool
+    AST *parallelSyntaxAnalysis(const std::vector<size_t> &declStarts, ThreadPool &pool, const DeclHook &onDecl);
 
-    // EBNF non-terminals
+    // index of the first token of each Decl, then of END; empty if not found
+    static std::vector<size_t> findDecls(const std::vector<Token> &tokens);
 
-    static void Program(AST *&root, Token *&tokenPtr);
+private:
+    TokenStream &tokenStream;
+    AstArena &arena;
 
-    static void DeclList(AST *&root, Token *&tokenPtr);
+    // ids already interned by this parser, without locking the Interner
+    mutable std::unordered_map<std::string_view, SymbolId> idCache;
 
-    static void Decl(AST *&root, Token *&tokenPtr);
+    // interned text of the token
+    SymbolId idOf(const Token &token) const;
 
-    static void VariableDecl(AST *&root, Token *&tokenPtr);
+    void throwInvalidTokenErr(const Token &token) const;
 
-    static void Type(AST *&root, Token *&tokenPtr);
+    void matchToken(TokenType tokenType, TokenStream &tokens) const;
 
-    static void FuncDecl(AST *&root, Token *&tokenPtr);
+    // EBNF non-terminals
 
-    static void Params(AST *&root, Token *&tokenPtr);
+    AST *Program(TokenStream &tokens);
 
-    static void ParamList(AST *&root, Token *&tokenPtr);
+    AST *DeclList(TokenStream &tokens);
 
-    static void Param(AST *&root, Token *&tokenPtr);
+    AST *Decl(TokenStream &tokens);
 
-    static void CompoundStmt(AST *&root, Token *&tokenPtr);
+    AST *VariableDecl(TokenStream &tokens);
 
-    static void LocalVariableDecl(AST *&root, Token *&tokenPtr);
+    AST *Type(TokenStream &tokens);
 
-    static void StmtList(AST *&root, Token *&tokenPtr);
+    AST *FuncDecl(TokenStream &tokens);
 
-    static void Stmt(AST *&root, Token *&tokenPtr);
+    AST *Params(TokenStream &tokens);
 
-    static void ExprStmt(AST *&root, Token *&tokenPtr);
+    AST *ParamList(TokenStream &tokens);
 
-    static void IfStmt(AST *&root, Token *&tokenPtr);
+    AST *Param(TokenStream &tokens);
 
-    static void WhileStmt(AST *&root, Token *&tokenPtr);
+    AST *CompoundStmt(TokenStream &tokens);
 
-    static void ReturnStmt(AST *&root, Token *&tokenPtr);
+    AST *LocalVariableDecl(TokenStream &tokens);
 
-    static void Expr(AST *&root, Token *&tokenPtr);
+    AST *StmtList(TokenStream &tokens);
 
-    static void Variable(AST *&root, Token *&tokenPtr);
+    AST *Stmt(TokenStream &tokens);
 
-    static void SimpleExpr(AST *&root, Token *&tokenPtr);
+    AST *ExprStmt(TokenStream &tokens);
 
-    static void RelationOp(AST *&root, Token *&tokenPtr);
+    AST *IfStmt(TokenStream &tokens);
 
-    static void AddExpr(AST *&root, Token *&tokenPtr);
+    AST *WhileStmt(TokenStream &tokens);
 
-    static void AddOp(AST *&root, Token *&tokenPtr);
+    AST *ReturnStmt(TokenStream &tokens);
 
-    static void Term(AST *&root, Token *&tokenPtr);
+    AST *Expr(TokenStream &tokens);
 
-    static void MulOp(AST *&root, Token *&tokenPtr);
+    AST *Variable(TokenStream &tokens);
 
-    static void Factor(AST *&root, Token *&tokenPtr);
+    // SimpleExpr, AddExpr and Term by precedence climbing
+    AST *BinaryExpr(AST *lhs, int minPrecedence, TokenStream &tokens);
 
-    static void Call(AST *&root, Token *&tokenPtr);
+    static int precedenceOf(TokenType tokenType);
 
-    static void ArgList(AST *&root, Token *&tokenPtr);
+    AST *Factor(TokenStream &tokens);
+
+    AST *Call(TokenStream &tokens);
+
+    AST *ArgList(TokenStream &tokens);
 };
 
 /*
@@ -125,4 +145,14 @@ Second(SimpleExpr) contains '(' from Call
 Second(Variable) doesn't contain '('
 
 But we still need to see whether '=' can be derived.
+
+Expression AST:
+SimpleExpr, AddExpr and Term are not nodes. A binary operator is the
+node of its operands, e.g. `a + b * 2` is
+    +
+  /   \
+ a     *
+      / \
+     b   2
+and `Variable '=' Expr` is a '=' node of them. Parentheses only group.
 */
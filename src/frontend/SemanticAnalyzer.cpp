@@ -1,96 +1,353 @@
 #include <iostream>
+#include <stdexcept>
+#include <unordered_set>
+#include <boost/format.hpp>
 #include "SemanticAnalyzer.h"
 #include "VariableAttribute.h"
 #include "Compiler.h"
 
+SemanticAnalyzer::SemanticAnalyzer(AST *root):
+    root(root),
+    inputId(Interner::global().intern("input")),
+    outputId(Interner::global().intern("output")) {}
+
 void SemanticAnalyzer::semanticAnalysis()
+{
+    vector<Locals> declLocals;
+    semanticAnalysis(declLocals);
+}
+
+/**
+ * @param declLocals declareLocals() of each FuncDecl, by index in
+ * DeclList (e.g. built while parsing in parallel), or empty
+ */
+void SemanticAnalyzer::semanticAnalysis(vector<Locals> &declLocals)
+{
+    beginDeclarations();
+
+    // 1. declare: all names are known before any is resolved
+    const AstChildren decls = root->getChildren();
+    for (int i = 0; i < decls.size(); i++)
+    {
+        if (declLocals.empty() || decls[i]->getTokenType() != TokenType::FUNC_DECL)
+        {
+            declareDecl(decls[i]);
+        }
+        else
+        {
+            growTables();
+            declareFunction(decls[i], std::move(declLocals.at(i)));
+        }
+    }
+
+    // 2. resolve: bind identifiers in function bodies
+    int scope = 0;
+    for (AST *const declNode : root->getChildren())
+    {
+        if (declNode->getTokenType() == TokenType::FUNC_DECL)
+        {
+            resolveFunction(declNode, ++scope);
+        }
+    }
+}
+
+void SemanticAnalyzer::beginDeclarations()
 {
     // function name cannot be $global
-    symbolTable[GLOBAL_SCOPE_NAME] = {};
+    symbolTable.clear();
+    symbolTable.emplace_back(Interner::global().intern(GLOBAL_SCOPE_NAME));
+
+    globalVariables.clear();
+    localVariables.clear();
+    functionScopes.clear();
+    growTables();
+
+    currentScope = 0;
+    globalIndex = 0;
+}
+
+// ids interned since the tables were sized are not declared yet
+void SemanticAnalyzer::growTables()
+{
+    const size_t idCount = Interner::global().size();
+    if (globalVariables.size() < idCount)
+    {
+        globalVariables.resize(idCount, -1);
+        localVariables.resize(idCount, -1);
+        functionScopes.resize(idCount, -1);
+    }
+}
 
-    int globalIndex = 0; // 索引全局变量（所有的全局变量视为一个数组）
+/**
+ * @brief Declare a global variable, or a function with its params and
+ * local variables, in a new scope
+ */
+void SemanticAnalyzer::declareDecl(AST *declNode, bool keepLocals)
+{
+    growTables();
 
-    for (const AST *const declNode : root->getChildren())
+    // global variable
+    if (declNode->getTokenType() == TokenType::VARIABLE_DECL)
     {
-        // global variable
-        if (declNode->getTokenType() == TokenType::VARIABLE_DECL)
+        declare(0, recognizeVariableDecl(declNode, globalIndex));
+    }
+    // global function
+    else if (declNode->getTokenType() == TokenType::FUNC_DECL)
+    {
+        declareFunction(declNode, declareLocals(declNode));
+        if (keepLocals == false)
+        {
+            dropLocals(symbolTable.size() - 1);
+        }
+    }
+}
+
+void SemanticAnalyzer::declareFunction(AST *declNode, Locals &&locals)
+{
+    // FuncDecl -> Type id '(' Params ')' CompoundStmt
+    AST *idNode = declNode->getChildren().at(1);
+    const SymbolId functionName = idNode->getTokenId();
+
+    const int scope = symbolTable.size();
+    symbolTable.emplace_back(functionName);
+    for (const VariableAttribute &variable : locals)
+    {
+        symbolTable.back().frame.push_back(variable.varSize);
+    }
+    symbolTable.back().variables = std::move(locals);
+    functionScopes.at(functionName) = scope;
+    idNode->setBinding({Binding::FUNCTION, scope});
+}
+
+/**
+ * @brief Params then local variables of a function, a redeclared name
+ * keeps its first declaration
+ * @details Reads the AST only, so functions can be declared on many threads.
+ */
+SemanticAnalyzer::Locals SemanticAnalyzer::declareLocals(const AST *declNode)
+{
+    // FuncDecl -> Type id '(' Params ')' CompoundStmt
+    // Params -> [ ParamList ]
+    const AstChildren children = declNode->getChildren();
+    Locals locals;
+    std::unordered_set<SymbolId> declared;
+    int localIndex = 0;
+
+    auto declareLocal = [&](const VariableAttribute &variableAttribute) {
+        if (declared.insert(variableAttribute.name).second)
         {
-            recognizeVariableDecl(declNode, GLOBAL_SCOPE_NAME, globalIndex);
+            locals.push_back(variableAttribute);
         }
-        // global function
-        else if (declNode->getTokenType() == TokenType::FUNC_DECL)
+    };
+
+    // params
+    if (children.at(2) != nullptr)
+    {
+        for (const AST *const param : children.at(2)->getChildren())
         {
-            // FuncDecl -> Type id '(' Params ')' CompoundStmt
-            // Params -> [ ParamList ]
-            int localIndex = 0;
-
-            const std::vector<AST *> &children = declNode->getChildren();
-            const string &functionType = children.at(0)->getTokenStr();
-            const string &functionName = children.at(1)->getTokenStr();
-
-            symbolTable[functionName] = {};
-            // params
-            if (children.at(2) != nullptr)
-            {
-                for (const AST *const param : children.at(2)->getChildren())
-                {
-                    recognizeParam(param, functionName, localIndex);
-                }
-            }
-
-            // local variables
-            // CompoundStmt -> '{' LocalVariableDecl StmtList '}'
-            // LocalVariableDecl -> { VariableDecl }
-            for (const AST *const varDecl : children.at(3)->getChildren().at(0)->getChildren()) 
-            {
-                recognizeVariableDecl(varDecl, functionName, localIndex);
-            }
+            declareLocal(recognizeParam(param, localIndex));
         }
     }
+
+    // local variables
+    // CompoundStmt -> '{' LocalVariableDecl StmtList '}'
+    // LocalVariableDecl -> { VariableDecl }
+    for (const AST *const varDecl : children.at(3)->getChildren().at(0)->getChildren())
+    {
+        declareLocal(recognizeVariableDecl(varDecl, localIndex));
+    }
+
+    return locals;
+}
+
+/**
+ * @brief Bind the identifiers in the body of a function
+ * @param scope of the function, i.e. 1 for the first declared one
+ */
+void SemanticAnalyzer::resolveFunction(AST *declNode, int scope)
+{
+    if (const AST *idNode = tryResolveFunction(declNode, scope))
+    {
+        throwIdNotFoundErr(idNode);
+    }
+}
+
+/**
+ * @brief resolveFunction(), unless an id is not declared yet
+ * @return the first id not declared (postorder), nullptr if all are bound
+ */
+AST *SemanticAnalyzer::tryResolveFunction(AST *declNode, int scope)
+{
+    growTables();
+
+    declNode->getChildren().at(1)->setBinding({Binding::FUNCTION, scope});
+    enterScope(scope);
+    AST *const idNode = resolve(declNode->getChildren().at(3));
+    leaveScope(scope);
+    return idNode;
+}
+
+// the same locals as declared first, the frame is unchanged
+void SemanticAnalyzer::redeclareLocals(AST *declNode, int scope)
+{
+    symbolTable.at(scope).variables = declareLocals(declNode);
+}
+
+void SemanticAnalyzer::dropLocals(int scope)
+{
+    Locals().swap(symbolTable.at(scope).variables);
+}
+
+int SemanticAnalyzer::scopeOf(SymbolId functionName) const
+{
+    return static_cast<size_t>(functionName) < functionScopes.size() ? functionScopes.at(functionName) : -1;
 }
 
 // VariableDecl -> Type Id [ '[' literal ']' ]
 /**
- * @details The number of symbol table entry 
+ * @details The number of symbol table entry
  * for an array of size k is k + 1. e.g.
- * int a[3]; &a, a[0], a[1], a[2] are all 
+ * int a[3]; &a, a[0], a[1], a[2] are all
  * in the symbol table, occupies 4 entries.
  * &a is the index of a.at(0).
  */
-inline void SemanticAnalyzer::recognizeVariableDecl(const AST *const declNode, const string &scopeName, int &scopeIndex)
+VariableAttribute SemanticAnalyzer::recognizeVariableDecl(const AST *const declNode, int &scopeIndex)
 {
-    // std::cout << "Test\n";
-    const std::vector<AST *> &children = declNode->getChildren();
-    const string &variableType = children.at(0)->getTokenStr();
-    const string &variableName = children.at(1)->getTokenStr();
-
-    // std::cout << "Set\n";
+    const AstChildren children = declNode->getChildren();
+    const VariableType variableType = children.at(0)->getTokenType() == TokenType::VOID ?
+        VariableType::VOID : VariableType::INT;
+    const SymbolId variableName = children.at(1)->getTokenId();
 
-    VariableAttribute variableAttribute(scopeIndex, variableType);
+    VariableAttribute variableAttribute(variableName, scopeIndex, variableType);
     int varSize = 0;
     if (children.size() >= 3)
     {
         variableAttribute.varSize = std::stoi(children.at(2)->getTokenStr());
     }
-    // symbolTable[scopeName][variableName] = variableAttribute;
-    symbolTable[scopeName].emplace(variableName, variableAttribute);
     scopeIndex += varSize + 1;
+    return variableAttribute;
 }
 
 // Param -> Type id [ '[' ']' ]
-inline void SemanticAnalyzer::recognizeParam(const AST *const paramNode, const string &scopeName, int &scopeIndex)
+VariableAttribute SemanticAnalyzer::recognizeParam(const AST *const paramNode, int &scopeIndex)
 {
-    // std::cout << "TestParam\n";
-
     // doesn't recognize array since passing by pointer
-    const std::vector<AST *> &paramChildren = paramNode->getChildren();
-    const string &variableType = paramChildren.at(0)->getTokenStr();
-    const string &variableName = paramChildren.at(1)->getTokenStr();
+    const AstChildren paramChildren = paramNode->getChildren();
+    const VariableType variableType = paramChildren.at(0)->getTokenType() == TokenType::VOID ?
+        VariableType::VOID : VariableType::INT;
+    const SymbolId variableName = paramChildren.at(1)->getTokenId();
 
-    // std::cout << "SetParam\n";
+    return VariableAttribute(variableName, scopeIndex++, variableType);
+}
 
-    VariableAttribute variableAttribute(scopeIndex, variableType);
+inline void SemanticAnalyzer::declare(int scope, const VariableAttribute &variableAttribute)
+{
+    auto &variables = symbolTable.at(scope).variables;
+    int &position = (scope == 0 ? globalVariables : localVariables).at(variableAttribute.name);
+    if (position == -1)
+    {
+        position = variables.size();
+        variables.push_back(variableAttribute);
+    }
+}
+
+// make the variables of a function visible
+void SemanticAnalyzer::enterScope(int scope)
+{
+    currentScope = scope;
+    const auto &variables = symbolTable.at(scope).variables;
+    for (int i = 0; i < variables.size(); i++)
+    {
+        localVariables.at(variables[i].name) = i;
+    }
+}
+
+void SemanticAnalyzer::leaveScope(int scope)
+{
+    for (const VariableAttribute &variable : symbolTable.at(scope).variables)
+    {
+        localVariables.at(variable.name) = -1;
+    }
+    currentScope = 0;
+}
 
-    symbolTable[scopeName].emplace(variableName, variableAttribute);
-    scopeIndex++;
+void SemanticAnalyzer::throwIdNotFoundErr(const AST *idNode)
+{
+    throw std::runtime_error((
+        boost::format("id %s not found in symbol table!") % idNode->getTokenStr())
+    .str());
+}
+
+/**
+ * @brief Postorder bind the ids of Variable / Call nodes under node
+ * @EBNF Variable -> id [ '[' Expr ']' ]
+ * @EBNF Call -> id '(' [ ArgList ] ')'
+ * @return the first id not declared, nullptr if all are bound
+ */
+AST *SemanticAnalyzer::resolve(AST *node)
+{
+    if (node == nullptr)
+    {
+        return nullptr;
+    }
+
+    for (AST *const child : node->getChildren())
+    {
+        if (AST *const idNode = resolve(child))
+        {
+            return idNode;
+        }
+    }
+
+    if (node->getTokenType() == TokenType::VARIABLE)
+    {
+        AST *const idNode = node->getChildren().at(0);
+        return resolveVariable(idNode) ? nullptr : idNode;
+    }
+    else if (node->getTokenType() == TokenType::CALL)
+    {
+        AST *const idNode = node->getChildren().at(0);
+        return resolveCall(idNode) ? nullptr : idNode;
+    }
+    return nullptr;
+}
+
+// locals shadow globals
+bool SemanticAnalyzer::resolveVariable(AST *idNode) const
+{
+    const SymbolId id = idNode->getTokenId();
+
+    int position = localVariables.at(id);
+    if (position != -1)
+    {
+        idNode->setBinding({Binding::LOCAL, symbolTable.at(currentScope).variables.at(position).variableIndex});
+        return true;
+    }
+
+    position = globalVariables.at(id);
+    if (position != -1)
+    {
+        idNode->setBinding({Binding::GLOBAL, symbolTable.at(0).variables.at(position).variableIndex});
+        return true;
+    }
+
+    return false;
+}
+
+// natives (input, output) are left unbound
+bool SemanticAnalyzer::resolveCall(AST *idNode) const
+{
+    const SymbolId id = idNode->getTokenId();
+    if (id == inputId || id == outputId)
+    {
+        return true;
+    }
+
+    const int scope = functionScopes.at(id);
+    if (scope == -1)
+    {
+        return false;
+    }
+    idNode->setBinding({Binding::FUNCTION, scope});
+    return true;
 }
@@ -1,31 +1,106 @@
 #pragma once
 
 #include <string>
-#include <unordered_map>
 #include <utility>
+#include <vector>
 #include "VariableAttribute.h"
 #include "AST.h"
 
-// { stirng: { string: VariableAttribute } }
-// { ScopeName: { VariableName: VariableAttribute } }
-using SymbolTable = std::unordered_map<string, std::unordered_map<string, VariableAttribute>>;
+// variables of a function, or of the global scope
+struct Scope {
+    SymbolId name;
 
-// 未做语义检查，仅负责生成符号表
+    // by variableIndex, a redeclared name keeps its first declaration
+    std::vector<VariableAttribute> variables;
+
+    // varSize of each variable of a function, kept when its variables
+    // are dropped: a caller pushes and pops the frame of its callee
+    // (see CodeGenerator::generateFrame())
+    std::vector<int> frame;
+
+    Scope(SymbolId name): name(name) {}
+};
+
+// scopes.at(0) is $global, functions follow in source order
+using SymbolTable = std::vector<Scope>;
+
+// 未做类型检查，仅负责生成符号表、绑定标识符
+/**
+ * @brief Builds the symbol table, then binds every identifier of a
+ * Variable or a Call to what it names (see Binding).
+ *
+ * @details Names are only looked up here, later phases read the bindings.
+ */
 class SemanticAnalyzer
 {
 public:
-    SemanticAnalyzer(): root(nullptr) {}
-    SemanticAnalyzer(AST *root): root(root) {}
+    SemanticAnalyzer(): SemanticAnalyzer(nullptr) {}
+    SemanticAnalyzer(AST *root);
+
+    // params then local variables of a function
+    using Locals = std::vector<VariableAttribute>;
 
     void semanticAnalysis();
+    void semanticAnalysis(std::vector<Locals> &declLocals);
+
+    static Locals declareLocals(const AST *declNode);
+
+    // A Decl at a time, for streaming compilation: after
+    // beginDeclarations(), declareDecl() every Decl, then
+    // resolveFunction() every FuncDecl (their ASTs may be parsed again).
+    // With tryResolveFunction(), a function is resolved as soon as the
+    // names it uses are declared (see --pipeline).
+    // Without keepLocals, a function keeps only its frame once declared:
+    // redeclareLocals() before resolving it, dropLocals() after.
+
+    void beginDeclarations();
+    void declareDecl(AST *declNode, bool keepLocals = true);
+    void resolveFunction(AST *declNode, int scope);
+    AST *tryResolveFunction(AST *declNode, int scope);
+
+    void redeclareLocals(AST *declNode, int scope);
+    void dropLocals(int scope);
 
     const SymbolTable &getSymbolTable() const {
         return symbolTable;
     }
+
+    // scope of the last function declared as functionName, -1 if none
+    int scopeOf(SymbolId functionName) const;
 private:
-    void recognizeVariableDecl(const AST *const declNode, const string &scopeName, int &scopeIndex);
-    void recognizeParam(const AST *const paramNode, const string &scopeName, int &scopeIndex);
+    void growTables();
+
+    void declareFunction(AST *declNode, Locals &&locals);
+
+    static VariableAttribute recognizeVariableDecl(const AST *const declNode, int &scopeIndex);
+    static VariableAttribute recognizeParam(const AST *const paramNode, int &scopeIndex);
+    void declare(int scope, const VariableAttribute &variableAttribute);
+
+    void enterScope(int scope);
+    void leaveScope(int scope);
+
+    AST *resolve(AST *node);
+    bool resolveVariable(AST *idNode) const;
+    bool resolveCall(AST *idNode) const;
+
+    static void throwIdNotFoundErr(const AST *idNode);
 
     AST *root;
     SymbolTable symbolTable;
-};
\ No newline at end of file
+
+    // natives, left unbound
+    const SymbolId inputId;
+    const SymbolId outputId;
+
+    // Indexed by SymbolId, -1 if not declared:
+    // position in Scope::variables of $global / of the current function
+    std::vector<int> globalVariables;
+    std::vector<int> localVariables;
+    // scope of a function
+    std::vector<int> functionScopes;
+
+    int currentScope = 0;
+
+    // 索引全局变量（所有的全局变量视为一个数组）
+    int globalIndex = 0;
+};
@@ -0,0 +1,80 @@
+#include "SourceBuffer.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+SourceBuffer::SourceBuffer(const string &filePath)
+{
+    const int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open source file " + filePath);
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || S_ISREG(fileStat.st_mode) == false) {
+        readFallback(fd, filePath);
+        close(fd);
+        return;
+    }
+
+    const size_t fileSize = fileStat.st_size;
+
+    // zero pages with room for the trailing '\0', then the file over them
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    mappingSize = (fileSize + 1 + pageSize - 1) / pageSize * pageSize;
+    mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        readFallback(fd, filePath);
+        close(fd);
+        return;
+    }
+
+    if (fileSize > 0 &&
+        mmap(mapping, fileSize, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        readFallback(fd, filePath);
+        close(fd);
+        return;
+    }
+    close(fd);
+
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+    text = static_cast<const char *>(mapping);
+    textSize = fileSize;
+}
+
+SourceBuffer::~SourceBuffer()
+{
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
+    }
+}
+
+void SourceBuffer::readFallback(int fd, const string &filePath)
+{
+    string contents;
+    char chunk[1 << 16];
+    while (true) {
+        const ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n < 0) {
+            close(fd);
+            throw std::runtime_error("Cannot read source file " + filePath);
+        }
+        if (n == 0) {
+            break;
+        }
+        contents.append(chunk, n);
+    }
+
+    // zeroed blocks with room for the trailing '\0'
+    fallback.resize(contents.size() / CharScan::ALIGNMENT + 1);
+    std::memcpy(fallback.data(), contents.data(), contents.size());
+    text = fallback.data()->bytes;
+    textSize = contents.size();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "CharScan.h"
+
+using std::string;
+
+/**
+ * @brief Read-only text of a source file, mmap'd once
+ *
+ * @details The text is followed by a '\0' (_EOF of the Lexer), so it can
+ * be scanned without bound checks. The file is mapped over a zeroed
+ * anonymous mapping one byte longer, which provides the '\0' even when
+ * the size of the file is a multiple of the page size. Files that cannot
+ * be mapped (e.g. pipes) are read into memory instead, into zeroed
+ * blocks. Either way the text is aligned and padded as CharScan needs.
+ *
+ * Tokens refer to the text by offset, so the buffer must outlive them.
+ */
+class SourceBuffer
+{
+public:
+    SourceBuffer() = default;
+    explicit SourceBuffer(const string &filePath);
+    ~SourceBuffer();
+
+    SourceBuffer(const SourceBuffer &) = delete;
+    SourceBuffer &operator=(const SourceBuffer &) = delete;
+
+    // '\0' terminated
+    const char *data() const {
+        return text;
+    }
+
+    size_t size() const {
+        return textSize;
+    }
+
+    std::string_view view() const {
+        return std::string_view(text, textSize);
+    }
+
+private:
+    struct alignas(CharScan::ALIGNMENT) Block {
+        char bytes[CharScan::ALIGNMENT];
+    };
+
+    // text of no source
+    static constexpr Block EMPTY{};
+
+    const char *text = EMPTY.bytes;
+    size_t textSize = 0;
+
+    // mapping of text, or nullptr if text is in fallback
+    void *mapping = nullptr;
+    size_t mappingSize = 0;
+    std::vector<Block> fallback;
+
+    void readFallback(int fd, const string &filePath);
+};
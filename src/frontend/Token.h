@@ -1,54 +1,63 @@
 #pragma once
 
-#include <string>
+#include <cstdint>
+#include <string_view>
 #include "TokenType.h"
 
-using std::string;
-using std::ostream;
-
+/**
+ * @brief A token as a view into the source text (see SourceBuffer)
+ *
+ * @details Tokens own no text: the text of a token is length bytes at
+ * offset of the source it was lexed from. 16 bytes per token; offsets
+ * are 64-bit, so a source may be larger than 4 GiB.
+ */
 class Token
 {
 public:
-    Token(TokenType tokenType, const string &tokenStr, int lineNo):
-        tokenType(tokenType), tokenStr(tokenStr), lineNo(lineNo) {}
+    // longest token text
+    static constexpr uint32_t MAX_LENGTH = (1u << 24) - 1;
+
+    Token(): Token(TokenType::END, 0, 0, 0) {}
+
+    Token(TokenType tokenType, uint64_t offset, uint32_t length, int lineNo):
+        offset(offset),
+        lineNo(lineNo),
+        length(length),
+        tokenType(static_cast<uint32_t>(tokenType)) {}
 
     TokenType getTokenType() const {
-        return tokenType;
+        return static_cast<TokenType>(tokenType);
+    }
+    uint64_t getOffset() const {
+        return offset;
     }
-    string &getTokenStr() {
-        return tokenStr;
+    uint32_t getLength() const {
+        return length;
     }
-    const string &getTokenStr() const {
-        return tokenStr;
+    std::string_view getTokenStr(std::string_view source) const {
+        return source.substr(offset, length);
     }
     int getLineNo() const {
         return lineNo;
     }
 
     bool isTypeToken() const {
-        return tokenType == TokenType::INT || tokenType == TokenType::VOID;
-    }
-
-    bool isKeywordToken() const {
-        return KEYWORD_MAP.find(tokenStr) != KEYWORD_MAP.end();
+        return getTokenType() == TokenType::INT || getTokenType() == TokenType::VOID;
     }
 
     bool isRelationOpToken() const {
-        return tokenType == TokenType::LESS       ||
-            tokenType == TokenType::LESS_EQUAL    ||
-            tokenType == TokenType::GREATER       ||
-            tokenType == TokenType::GREATER_EQUAL ||
-            tokenType == TokenType::EQUAL         ||
-            tokenType == TokenType::NOT_EQUAL;
-    }
-
-    friend ostream &operator<<(ostream &out, Token t) {
-        out << t.tokenStr;
-        return out;
+        const TokenType type = getTokenType();
+        return type == TokenType::LESS       ||
+            type == TokenType::LESS_EQUAL    ||
+            type == TokenType::GREATER       ||
+            type == TokenType::GREATER_EQUAL ||
+            type == TokenType::EQUAL         ||
+            type == TokenType::NOT_EQUAL;
     }
 
 private:
-    TokenType tokenType;
-    string tokenStr;
+    uint64_t offset;
     int lineNo;
+    uint32_t length : 24;
+    uint32_t tokenType : 8;
 };
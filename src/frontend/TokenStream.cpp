@@ -0,0 +1,54 @@
+#include "TokenStream.h"
+
+TokenStream::TokenStream(const Lexer &lexer):
+    source(lexer.getSource().view()),
+    text(lexer.getSource().data()),
+    textPtr(text)
+{
+    fill();
+}
+
+TokenStream::TokenStream(const Lexer &lexer, const std::vector<Token> &tokens):
+    source(lexer.getSource().view()),
+    text(lexer.getSource().data()),
+    textPtr(text),
+    lexedFirst(tokens.data()),
+    lexed(tokens.data()),
+    lexedLast(tokens.data() + tokens.size() - 1)
+{
+    fill();
+}
+
+TokenStream::TokenStream(const Lexer &lexer, BatchSource nextBatch):
+    source(lexer.getSource().view()),
+    text(lexer.getSource().data()),
+    textPtr(text),
+    nextBatch(std::move(nextBatch))
+{
+    pullBatch();
+    fill();
+}
+
+void TokenStream::pullBatch()
+{
+    nextBatch(batch);
+    lexed = batch.data();
+    lexedLast = batch.data() + batch.size() - 1;
+}
+
+TokenStream TokenStream::from(size_t index) const
+{
+    TokenStream stream(*this);
+    stream.lexed = lexedFirst + index;
+    stream.head = 0;
+    stream.tokenCount = 0;
+    stream.fill();
+    return stream;
+}
+
+void TokenStream::fill()
+{
+    for (Token &token : ring) {
+        token = lexed == nullptr ? Lexer::scanToken(text, textPtr, lineNo) : nextLexed();
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <functional>
+#include <string_view>
+#include <vector>
+#include "Lexer.h"
+#include "Token.h"
+
+/**
+ * @brief Tokens of a source, lexed on demand as the Parser pulls them
+ *
+ * @details Only a ring of the current token and the next LOOKAHEAD - 1
+ * ones is kept, so the memory of the stream doesn't grow with the
+ * source. The stream stays at END once reached: peeking or advancing
+ * past it returns END again.
+ * The tokens may also be lexed beforehand, e.g. by
+ * Lexer::parallelLexicalAnalysis(): the stream then reads them in turn.
+ * Or they come in batches, e.g. from a lexer thread (see --pipeline).
+ */
+class TokenStream
+{
+public:
+    // tokens the parser may see at once: the current one and 2 more (Decl)
+    static constexpr int LOOKAHEAD = 4;
+
+    // lexer must outlive the stream
+    explicit TokenStream(const Lexer &lexer);
+
+    // tokens of lexer, ending with END, must outlive the stream
+    TokenStream(const Lexer &lexer, const std::vector<Token> &tokens);
+
+    // fills batch with the next tokens (at least one), the last batch ends with END
+    using BatchSource = std::function<void(std::vector<Token> &batch)>;
+
+    TokenStream(const Lexer &lexer, BatchSource nextBatch);
+
+    // of tokens lexed beforehand: the same tokens, from the index-th one
+    TokenStream from(size_t index) const;
+
+    // the current token
+    const Token &operator*() const {
+        return ring[head];
+    }
+    const Token *operator->() const {
+        return &ring[head];
+    }
+
+    // k tokens after the current one, k < LOOKAHEAD
+    const Token &peek(int k) const {
+        return ring[(head + k) % LOOKAHEAD];
+    }
+
+    // pull the next token, lexing one more into the ring
+    void advance() {
+        ring[head] = lexed == nullptr ? Lexer::scanToken(text, textPtr, lineNo) : nextLexed();
+        head = (head + 1) % LOOKAHEAD;
+        tokenCount++;
+    }
+
+    // text the tokens refer to
+    std::string_view getSource() const {
+        return source;
+    }
+
+    // tokens advanced over
+    long long getTokenCount() const {
+        return tokenCount;
+    }
+
+private:
+    std::string_view source;
+    const char *text;
+    const char *textPtr;
+    int lineNo = 1;
+
+    // tokens lexed beforehand, nullptr if lexed on demand
+    const Token *lexedFirst = nullptr;
+    const Token *lexed = nullptr;
+    const Token *lexedLast = nullptr; // END, unless of a batch
+
+    // tokens of the current batch, lexed points into it
+    std::vector<Token> batch;
+    BatchSource nextBatch;
+
+    Token ring[LOOKAHEAD];
+    int head = 0;
+    long long tokenCount = 0;
+
+    // lex the first LOOKAHEAD tokens from textPtr
+    void fill();
+
+    // the batch is replaced after its last token, so not a reference
+    Token nextLexed() {
+        const Token token = *lexed;
+        if (lexed != lexedLast) {
+            lexed++;
+        } else if (token.getTokenType() != TokenType::END) {
+            pullBatch();
+        }
+        return token;
+    }
+
+    void pullBatch();
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <unordered_set>
+#include <string>
 #include <unordered_map>
 
 // TODO: 没有浮点数，懒得做
@@ -63,11 +64,7 @@ enum class TokenType
     IF_STMT,
     WHILE_STMT,
     RETURN_STMT,
-    EXPR,
     VARIABLE,
-    SIMPLE_EXPR,
-    ADD_EXPR,
-    TERM,
     CALL,
     ARG_LIST,
 };
@@ -1,31 +1,53 @@
 #pragma once
 
-#include <string>
+#include "Interner.h"
 
-using std::string;
+enum class VariableType
+{
+    INT,
+    VOID,
+};
 
 struct VariableAttribute {
+    SymbolId name;
+
     // use to index variable in the scope
-    int variableIndex;  
+    int variableIndex;
 
     // Type::tokenStr
-    string variableType;
+    VariableType variableType;
 
     // int occupies one size. int array[n] means varSize = n.
     int varSize;
 
-    VariableAttribute():
-        variableIndex(-1), 
-        variableType(""),
-        varSize(0) {}  
-
-    VariableAttribute(int variableIndex, const string &variableType):
-        variableIndex(variableIndex), 
+    VariableAttribute(SymbolId name, int variableIndex, VariableType variableType):
+        name(name),
+        variableIndex(variableIndex),
         variableType(variableType),
         varSize(0) {}
-    
-    VariableAttribute(int variableIndex, const string &variableType, int varSize):
-        variableIndex(variableIndex), 
+
+    VariableAttribute(SymbolId name, int variableIndex, VariableType variableType, int varSize):
+        name(name),
+        variableIndex(variableIndex),
         variableType(variableType),
         varSize(varSize) {}
-};
\ No newline at end of file
+};
+
+/**
+ * @brief What an identifier names, resolved by SemanticAnalyzer
+ *
+ * @details LOCAL / GLOBAL: index is the slot of the variable, i.e. its
+ * VariableAttribute::variableIndex. FUNCTION: index is the scope of the
+ * function in the SymbolTable.
+ */
+struct Binding {
+    enum Kind : unsigned char {
+        NONE,
+        LOCAL,
+        GLOBAL,
+        FUNCTION,
+    };
+
+    Kind kind = NONE;
+    int index = -1;
+};
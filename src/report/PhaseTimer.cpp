@@ -0,0 +1,84 @@
+#include "PhaseTimer.h"
+
+#include <boost/format.hpp>
+#include <sys/resource.h>
+#include "Probes.h"
+
+PhaseTimer::PhaseTimer():
+    startTime(std::chrono::steady_clock::now()),
+    phaseStartPeakRssKb(0) {}
+
+long PhaseTimer::getPeakRssKb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+void PhaseTimer::begin(const string &phaseName)
+{
+    this->phaseName = phaseName;
+    CMINUS_PROBE1(phase__start, this->phaseName.c_str());
+    phaseStartPeakRssKb = getPeakRssKb();
+    phaseStartTime = std::chrono::steady_clock::now();
+}
+
+void PhaseTimer::end(const ObjectCounts &objectCounts)
+{
+    const auto phaseEndTime = std::chrono::steady_clock::now();
+    CMINUS_PROBE1(phase__end, phaseName.c_str());
+    using Ms = std::chrono::duration<double, std::milli>;
+
+    records.push_back({
+        phaseName,
+        Ms(phaseStartTime - startTime).count(),
+        Ms(phaseEndTime - phaseStartTime).count(),
+        getPeakRssKb() - phaseStartPeakRssKb,
+        objectCounts
+    });
+}
+
+void PhaseTimer::print(std::ostream &out) const
+{
+    double totalMs = 0;
+    for (const auto &record : records) {
+        totalMs += record.wallMs;
+    }
+
+    out << boost::format("%-18s %12s %8s %16s  %s\n") % "phase" % "wall (ms)" % "wall %" % "peak RSS +(KB)" % "objects";
+    for (const auto &record : records) {
+        string objects;
+        for (const auto &[name, count] : record.objectCounts) {
+            objects += (boost::format("%s%d %s") % (objects.empty() ? "" : ", ") % count % name).str();
+        }
+        out << boost::format("%-18s %12.3f %7.2f%% %16d  %s\n")
+            % record.name % record.wallMs % (totalMs > 0 ? 100 * record.wallMs / totalMs : 0.0)
+            % record.peakRssDeltaKb % objects;
+    }
+    out << boost::format("%-18s %12.3f\n") % "total" % totalMs;
+}
+
+Json::Value PhaseTimer::toChromeTrace() const
+{
+    Json::Value ret;
+    ret["traceEvents"] = Json::arrayValue;
+
+    for (const auto &record : records) {
+        Json::Value event;
+        event["name"] = record.name;
+        event["ph"] = "X";
+        event["ts"] = record.startMs * 1000;
+        event["dur"] = record.wallMs * 1000;
+        event["pid"] = 1;
+        event["tid"] = 1;
+
+        event["args"]["peak_rss_delta_kb"] = Json::Int64(record.peakRssDeltaKb);
+        for (const auto &[name, count] : record.objectCounts) {
+            event["args"][name] = Json::Int64(count);
+        }
+
+        ret["traceEvents"].append(event);
+    }
+
+    return ret;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <json/json.h>
+
+using std::pair;
+using std::string;
+using std::vector;
+
+// { ObjectName: Count }, e.g. { "tokens": 1024 }
+using ObjectCounts = vector<pair<string, long long>>;
+
+struct PhaseRecord {
+    string name;
+    double startMs;
+    double wallMs;
+    long peakRssDeltaKb;
+    ObjectCounts objectCounts;
+};
+
+/**
+ * @brief Wall time, peak RSS growth and object counts of compiler phases
+ *
+ * @details Phases are sequential: begin() a phase, end() it with the
+ * number of objects it produced.
+ */
+class PhaseTimer
+{
+public:
+    PhaseTimer();
+
+    void begin(const string &phaseName);
+    void end(const ObjectCounts &objectCounts = {});
+
+    void print(std::ostream &out) const;
+
+    // Chrome trace event format (chrome://tracing, Perfetto)
+    Json::Value toChromeTrace() const;
+
+private:
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::time_point phaseStartTime;
+    long phaseStartPeakRssKb;
+    string phaseName;
+
+    vector<PhaseRecord> records;
+
+    static long getPeakRssKb();
+};
@@ -0,0 +1,129 @@
+#include "SizeReport.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <boost/format.hpp>
+
+SizeReport::SizeReport(const vector<Instruction> &insts, const vector<FuncSymbol> &funcSymbols,
+                       const string &srcFilePath, int topLineCount):
+    totalCount(insts.size()), categoryCounts{}
+{
+    for (const auto &inst : insts) {
+        categoryCounts[int(inst.category)]++;
+    }
+
+    // funcSymbols are sorted by start and cover all the code
+    for (const auto &func : funcSymbols) {
+        FuncSize funcSize {func.name, func.end - func.start, {}};
+        for (int pc = func.start; pc < func.end; pc++) {
+            funcSize.categoryCounts[int(insts.at(pc).category)]++;
+        }
+        funcSizes.push_back(funcSize);
+    }
+    std::stable_sort(funcSizes.begin(), funcSizes.end(), [](const auto &a, const auto &b) {
+        return a.instCount > b.instCount;
+    });
+
+    std::map<int, long long> lineCounts;
+    for (const auto &inst : insts) {
+        if (inst.lineNo > 0) {
+            lineCounts[inst.lineNo]++;
+        }
+    }
+    for (const auto &[lineNo, count] : lineCounts) {
+        lineSizes.push_back({lineNo, count, ""});
+    }
+    std::stable_sort(lineSizes.begin(), lineSizes.end(), [](const auto &a, const auto &b) {
+        return a.instCount > b.instCount;
+    });
+    if (lineSizes.size() > size_t(topLineCount)) {
+        lineSizes.resize(topLineCount);
+    }
+
+    // attach source text of the reported lines
+    std::map<int, string *> wantedLines;
+    for (auto &lineSize : lineSizes) {
+        wantedLines[lineSize.lineNo] = &lineSize.sourceText;
+    }
+    std::ifstream readFile(srcFilePath);
+    string line;
+    for (int lineNo = 1; wantedLines.empty() == false && std::getline(readFile, line); lineNo++) {
+        auto iter = wantedLines.find(lineNo);
+        if (iter != wantedLines.end()) {
+            const size_t first = line.find_first_not_of(" \t");
+            *iter->second = first == string::npos ? "" : line.substr(first);
+            wantedLines.erase(iter);
+        }
+    }
+}
+
+void SizeReport::print(std::ostream &out) const
+{
+    const auto percent = [this](long long count) {
+        return totalCount > 0 ? 100.0 * count / totalCount : 0.0;
+    };
+
+    out << boost::format("%-16s %10s %8s\n") % "category" % "insts" % "insts %";
+    for (int i = 0; i < INST_CATEGORY_COUNT; i++) {
+        if (categoryCounts[i] > 0) {
+            out << boost::format("%-16s %10d %7.2f%%\n") % INST_CATEGORY_NAMES[i] % categoryCounts[i] % percent(categoryCounts[i]);
+        }
+    }
+    out << boost::format("%-16s %10d\n\n") % "total" % totalCount;
+
+    out << boost::format("%-24s %10s %8s  %s\n") % "function" % "insts" % "insts %" % "by category";
+    for (const auto &funcSize : funcSizes) {
+        string categories;
+        for (int i = 0; i < INST_CATEGORY_COUNT; i++) {
+            if (funcSize.categoryCounts[i] > 0) {
+                categories += (boost::format("%s%s %d") % (categories.empty() ? "" : ", ")
+                               % INST_CATEGORY_NAMES[i] % funcSize.categoryCounts[i]).str();
+            }
+        }
+        out << boost::format("%-24s %10d %7.2f%%  %s\n") % funcSize.name % funcSize.instCount % percent(funcSize.instCount) % categories;
+    }
+    out << "\n";
+
+    out << boost::format("%-8s %10s  %s\n") % "line" % "insts" % "source";
+    for (const auto &lineSize : lineSizes) {
+        out << boost::format("%-8d %10d  %s\n") % lineSize.lineNo % lineSize.instCount % lineSize.sourceText;
+    }
+}
+
+Json::Value SizeReport::toJson() const
+{
+    const auto categoriesToJson = [](const CategoryCounts &counts) {
+        Json::Value ret = Json::objectValue;
+        for (int i = 0; i < INST_CATEGORY_COUNT; i++) {
+            if (counts[i] > 0) {
+                ret[INST_CATEGORY_NAMES[i]] = Json::Int64(counts[i]);
+            }
+        }
+        return ret;
+    };
+
+    Json::Value ret;
+    ret["total"] = Json::Int64(totalCount);
+    ret["categories"] = categoriesToJson(categoryCounts);
+
+    ret["functions"] = Json::arrayValue;
+    for (const auto &funcSize : funcSizes) {
+        Json::Value func;
+        func["name"] = funcSize.name;
+        func["insts"] = Json::Int64(funcSize.instCount);
+        func["categories"] = categoriesToJson(funcSize.categoryCounts);
+        ret["functions"].append(func);
+    }
+
+    ret["lines"] = Json::arrayValue;
+    for (const auto &lineSize : lineSizes) {
+        Json::Value line;
+        line["line"] = lineSize.lineNo;
+        line["insts"] = Json::Int64(lineSize.instCount);
+        line["source"] = lineSize.sourceText;
+        ret["lines"].append(line);
+    }
+
+    return ret;
+}
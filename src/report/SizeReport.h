@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <json/json.h>
+#include "backend/Instruction.h"
+#include "backend/SymbolMap.h"
+
+using std::string;
+using std::vector;
+
+using CategoryCounts = std::array<long long, INST_CATEGORY_COUNT>;
+
+struct FuncSize {
+    string name;
+    long long instCount;
+    CategoryCounts categoryCounts;
+};
+
+struct LineSize {
+    int lineNo;
+    long long instCount;
+    string sourceText;
+};
+
+/**
+ * @brief Static code size of the emitted instructions, by function,
+ * by source construct (InstCategory) and by source line.
+ */
+class SizeReport
+{
+public:
+    SizeReport(const vector<Instruction> &insts, const vector<FuncSymbol> &funcSymbols,
+               const string &srcFilePath, int topLineCount = 10);
+
+    void print(std::ostream &out) const;
+
+    Json::Value toJson() const;
+
+private:
+    long long totalCount;
+    CategoryCounts categoryCounts;
+    vector<FuncSize> funcSizes;
+
+    // the topLineCount largest lines
+    vector<LineSize> lineSizes;
+};
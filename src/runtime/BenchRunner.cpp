@@ -0,0 +1,98 @@
+#include "BenchRunner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <boost/format.hpp>
+#include "backend/VM.h"
+#include "HashingStreamBuf.h"
+
+void BenchRunner::run(const string &input)
+{
+    HashingStreamBuf outputBuf(hashOutput);
+    std::ostream output(&outputBuf);
+
+    // counting run
+    {
+        VM vm(codes);
+        VMMonitor counter;
+        vm.addMonitor(&counter);
+
+        std::istringstream inputStream(input);
+        vm.setIO(inputStream, output);
+        vm.run();
+
+        instCount = vm.getCounters().instCount;
+        outputHash = outputBuf.getHash();
+    }
+
+    VM vm(codes);
+    for (int i = 0; i < warmup + repeat; i++) {
+        std::istringstream inputStream(input);
+        vm.setIO(inputStream, output);
+        outputBuf.reset();
+
+        const auto start = std::chrono::steady_clock::now();
+        vm.run();
+        const auto end = std::chrono::steady_clock::now();
+
+        if (outputBuf.getHash() != outputHash) {
+            outputStable = false;
+        }
+        if (i >= warmup) {
+            runSeconds.push_back(std::chrono::duration<double>(end - start).count());
+        }
+    }
+    std::sort(runSeconds.begin(), runSeconds.end());
+}
+
+// nearest-rank percentile of the run times
+double BenchRunner::getPercentile(double percent) const
+{
+    if (runSeconds.empty()) {
+        return 0;
+    }
+    const int rank = std::ceil(percent / 100 * runSeconds.size());
+    return runSeconds.at(std::max(rank, 1) - 1);
+}
+
+void BenchRunner::print(std::ostream &out) const
+{
+    const double median = getPercentile(50);
+
+    out << boost::format("%-24s %d (+%d warm-up)\n") % "runs" % repeat % warmup
+        << boost::format("%-24s %d\n") % "instructions" % instCount
+        << boost::format("%-24s %.6f\n") % "min (s)" % getPercentile(0)
+        << boost::format("%-24s %.6f\n") % "median (s)" % median
+        << boost::format("%-24s %.6f\n") % "p99 (s)" % getPercentile(99)
+        << boost::format("%-24s %.0f\n") % "instructions per second" % (median > 0 ? instCount / median : 0);
+    if (hashOutput) {
+        out << boost::format("%-24s %016x%s\n") % "output hash" % outputHash
+            % (outputStable ? "" : " (differs between runs)");
+    }
+}
+
+Json::Value BenchRunner::toJson() const
+{
+    const double median = getPercentile(50);
+
+    Json::Value ret;
+    ret["runs"] = repeat;
+    ret["warmup"] = warmup;
+    ret["instructions"] = Json::Int64(instCount);
+    ret["min_seconds"] = getPercentile(0);
+    ret["median_seconds"] = median;
+    ret["p99_seconds"] = getPercentile(99);
+    ret["instructions_per_second"] = median > 0 ? instCount / median : 0;
+    ret["run_seconds"] = Json::arrayValue;
+    for (const double seconds : runSeconds) {
+        ret["run_seconds"].append(seconds);
+    }
+    if (hashOutput) {
+        ret["output_hash"] = (boost::format("%016x") % outputHash).str();
+        ret["output_stable"] = outputStable;
+    }
+
+    return ret;
+}
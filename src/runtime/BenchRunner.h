@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <json/json.h>
+#include "backend/VMInst.h"
+
+using std::string;
+using std::vector;
+
+/**
+ * @brief Repeated runs of one program in one process (cm --bench)
+ *
+ * @details Every run replays the same captured input, and its output is
+ * discarded or hashed. Only VM::run() of the plain dispatch loop is timed;
+ * the instruction count comes from one extra monitored run.
+ */
+class BenchRunner
+{
+public:
+    BenchRunner(const vector<VMInst> &codes, int warmup, int repeat, bool hashOutput):
+        codes(codes), warmup(warmup), repeat(repeat), hashOutput(hashOutput) {}
+
+    void run(const string &input);
+
+    void print(std::ostream &out) const;
+    Json::Value toJson() const;
+
+private:
+    const vector<VMInst> &codes;
+    int warmup;
+    int repeat;
+    bool hashOutput;
+
+    long long instCount = 0;
+    vector<double> runSeconds; // sorted
+
+    uint64_t outputHash = 0;
+    bool outputStable = true;  // same hash in every run
+
+    double getPercentile(double percent) const;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <streambuf>
+
+/**
+ * @brief Unbuffered streambuf forwarding to another one, counting the
+ * bytes consumed from it / written to it.
+ *
+ * @details Characters which are only peeked (sgetc) are not counted.
+ */
+class CountingStreamBuf : public std::streambuf
+{
+public:
+    CountingStreamBuf(std::streambuf *target): target(target), count(0) {}
+
+    long long getCount() const {
+        return count;
+    }
+
+protected:
+    int_type underflow() override {
+        return target->sgetc();
+    }
+
+    int_type uflow() override {
+        const int_type c = target->sbumpc();
+        if (traits_type::eq_int_type(c, traits_type::eof()) == false) {
+            count++;
+        }
+        return c;
+    }
+
+    int_type overflow(int_type c) override {
+        if (traits_type::eq_int_type(c, traits_type::eof())) {
+            return traits_type::not_eof(c);
+        }
+        if (traits_type::eq_int_type(target->sputc(traits_type::to_char_type(c)), traits_type::eof())) {
+            return traits_type::eof();
+        }
+        count++;
+        return c;
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) override {
+        const std::streamsize written = target->sputn(s, n);
+        count += written;
+        return written;
+    }
+
+    int sync() override {
+        return target->pubsync();
+    }
+
+private:
+    std::streambuf *target;
+    long long count;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <streambuf>
+
+/**
+ * @brief Output streambuf discarding everything written to it,
+ * optionally hashing it (64-bit FNV-1a) to compare outputs of runs.
+ */
+class HashingStreamBuf : public std::streambuf
+{
+public:
+    HashingStreamBuf(bool hashing): hashing(hashing), hash(FNV_OFFSET_BASIS) {}
+
+    uint64_t getHash() const {
+        return hash;
+    }
+
+    void reset() {
+        hash = FNV_OFFSET_BASIS;
+    }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (traits_type::eq_int_type(c, traits_type::eof())) {
+            return traits_type::not_eof(c);
+        }
+        if (hashing) {
+            update(traits_type::to_char_type(c));
+        }
+        return c;
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) override {
+        if (hashing) {
+            for (std::streamsize i = 0; i < n; i++) {
+                update(s[i]);
+            }
+        }
+        return n;
+    }
+
+private:
+    static const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+    static const uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+    bool hashing;
+    uint64_t hash;
+
+    void update(char c) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * FNV_PRIME;
+    }
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Layout of the live stats file shared by `cm --live-stats` and
+ * `cmstat`.
+ *
+ * @details The writer maps the file and updates the counters with
+ * relaxed atomic stores, a reader maps the same file read-only. Counters
+ * are independent, a reader may see them from slightly different points
+ * of the run. `magic` is stored last (release) once the page is set up.
+ */
+struct LiveStatsPage {
+    std::atomic<uint64_t> magic;
+    uint32_t version;
+    uint32_t pid;
+
+    std::atomic<uint32_t> state;
+
+    std::atomic<uint64_t> instCount;
+    std::atomic<int64_t> pc;
+    std::atomic<int64_t> funcEntry;
+    std::atomic<int64_t> callDepth;
+    std::atomic<int64_t> stackWords;
+    std::atomic<uint64_t> bytesRead;
+    std::atomic<uint64_t> bytesWritten;
+
+    // number of publishes, a reader can tell a stuck job from a slow one
+    std::atomic<uint64_t> updateCount;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "live stats need lock-free 64-bit atomics");
+
+const uint64_t LIVE_STATS_MAGIC = 0x5354415453434dULL; // "CMSTATS"
+const uint32_t LIVE_STATS_VERSION = 1;
+
+enum LiveStatsState : uint32_t
+{
+    LIVE_STATS_RUNNING = 1,
+    LIVE_STATS_FINISHED = 2,
+    // stopped by a runtime error
+    LIVE_STATS_FAILED = 3,
+};
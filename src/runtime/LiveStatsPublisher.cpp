@@ -0,0 +1,154 @@
+#include "LiveStatsPublisher.h"
+
+#include <new>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+volatile std::sig_atomic_t LiveStatsPublisher::publishDue = 0;
+
+LiveStatsPublisher::~LiveStatsPublisher()
+{
+    unmap();
+}
+
+/**
+ * @details The page is set up in a temporary file, then renamed to
+ * statsFilePath: a file at statsFilePath may be mapped by a viewer (e.g.
+ * of the last run), so it is never truncated, and a viewer never sees a
+ * short file.
+ */
+void LiveStatsPublisher::open(const VM &vm)
+{
+    // in the same directory, so that rename() is atomic
+    string tempPath = statsFilePath + ".XXXXXX";
+
+    const int fd = mkstemp(tempPath.data());
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open live stats file " + statsFilePath);
+    }
+    if (fchmod(fd, 0644) != 0 || ftruncate(fd, sizeof(LiveStatsPage)) != 0) {
+        close(fd);
+        unlink(tempPath.c_str());
+        throw std::runtime_error("Cannot resize live stats file " + statsFilePath);
+    }
+
+    void *addr = mmap(nullptr, sizeof(LiveStatsPage), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        unlink(tempPath.c_str());
+        throw std::runtime_error("Cannot map live stats file " + statsFilePath);
+    }
+
+    page = new (addr) LiveStatsPage();
+    updateCount = 0;
+    page->version = LIVE_STATS_VERSION;
+    page->pid = getpid();
+    page->state.store(LIVE_STATS_RUNNING, std::memory_order_relaxed);
+    publish(vm);
+    page->magic.store(LIVE_STATS_MAGIC, std::memory_order_release);
+
+    if (std::rename(tempPath.c_str(), statsFilePath.c_str()) != 0) {
+        unmap();
+        unlink(tempPath.c_str());
+        throw std::runtime_error("Cannot create live stats file " + statsFilePath);
+    }
+}
+
+void LiveStatsPublisher::onRunStart(const VM &)
+{
+    startTimer();
+}
+
+void LiveStatsPublisher::onRunEnd(const VM &vm)
+{
+    finish(vm, LIVE_STATS_FINISHED);
+}
+
+void LiveStatsPublisher::onRunAbort(const VM &vm)
+{
+    // unmapped if onRunEnd() did
+    if (page != nullptr) {
+        finish(vm, LIVE_STATS_FAILED);
+    }
+}
+
+void LiveStatsPublisher::onPoll(const VM &vm)
+{
+    if (publishDue) {
+        publishDue = 0;
+        publish(vm);
+    }
+}
+
+void LiveStatsPublisher::finish(const VM &vm, LiveStatsState state)
+{
+    stopTimer();
+    publish(vm);
+    page->state.store(state, std::memory_order_release);
+    unmap();
+}
+
+void LiveStatsPublisher::publish(const VM &vm)
+{
+    const auto &counters = vm.getCounters();
+    const auto relaxed = std::memory_order_relaxed;
+
+    page->instCount.store(counters.instCount, relaxed);
+    page->pc.store(vm.getPc(), relaxed);
+    page->funcEntry.store(vm.getFuncEntry(), relaxed);
+    page->callDepth.store(counters.callDepth, relaxed);
+    page->stackWords.store(vm.getStackSize(), relaxed);
+    page->bytesRead.store(inputBuf.getCount(), relaxed);
+    page->bytesWritten.store(outputBuf.getCount(), relaxed);
+    // single writer, no read-modify-write needed
+    page->updateCount.store(++updateCount, relaxed);
+}
+
+void LiveStatsPublisher::handleSignal(int)
+{
+    publishDue = 1;
+    VM::requestPoll();
+}
+
+void LiveStatsPublisher::startTimer()
+{
+    struct sigaction action = {};
+    action.sa_handler = handleSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGALRM, &action, nullptr) != 0) {
+        throw std::runtime_error("Cannot handle SIGALRM for live stats");
+    }
+
+    struct itimerval timer = {};
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = PUBLISH_INTERVAL_US;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_REAL, &timer, nullptr) != 0) {
+        throw std::runtime_error("Cannot start the live stats timer");
+    }
+}
+
+void LiveStatsPublisher::stopTimer()
+{
+    struct itimerval timer = {};
+    setitimer(ITIMER_REAL, &timer, nullptr);
+
+    signal(SIGALRM, SIG_IGN);
+    publishDue = 0;
+}
+
+void LiveStatsPublisher::unmap()
+{
+    if (page != nullptr) {
+        munmap(page, sizeof(LiveStatsPage));
+        page = nullptr;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <csignal>
+#include <string>
+#include "backend/VM.h"
+#include "backend/VMMonitor.h"
+#include "CountingStreamBuf.h"
+#include "LiveStatsPage.h"
+
+using std::string;
+
+/**
+ * @brief Publish VM counters into a mmap'd LiveStatsPage, driven by a
+ * SIGALRM interval timer.
+ *
+ * @details Like SamplingProfiler, the signal handler only raises
+ * VM::requestPoll(), the page is written in onPoll(). So the VM loop
+ * pays nothing between two publishes. Always published at the start and
+ * the end of the run.
+ */
+class LiveStatsPublisher : public VMMonitor
+{
+public:
+    LiveStatsPublisher(const string &statsFilePath,
+                       const CountingStreamBuf &inputBuf, const CountingStreamBuf &outputBuf):
+        statsFilePath(statsFilePath), inputBuf(inputBuf), outputBuf(outputBuf), page(nullptr) {}
+
+    ~LiveStatsPublisher();
+
+    // create the page before the run, so that a bad path fails before
+    // the program runs
+    void open(const VM &vm);
+
+    void onRunStart(const VM &vm) override;
+    void onRunEnd(const VM &vm) override;
+    void onRunAbort(const VM &vm) override;
+    void onPoll(const VM &vm) override;
+
+    bool observesControlFlow() const override {
+        return false;
+    }
+
+private:
+    string statsFilePath;
+    const CountingStreamBuf &inputBuf;
+    const CountingStreamBuf &outputBuf;
+
+    LiveStatsPage *page;
+    uint64_t updateCount = 0;
+
+    // publish period of the wall clock timer, 10 ms: far below the one
+    // second refresh of cmstat, and rare enough to cost the VM little
+    static constexpr int PUBLISH_INTERVAL_US = 10000;
+
+    // set by the timer, other monitors may request polls as well
+    static volatile std::sig_atomic_t publishDue;
+
+    void publish(const VM &vm);
+    // last publish, then the terminal state
+    void finish(const VM &vm, LiveStatsState state);
+    void unmap();
+
+    static void startTimer();
+    static void stopTimer();
+    static void handleSignal(int);
+};
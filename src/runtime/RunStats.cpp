@@ -0,0 +1,54 @@
+#include "RunStats.h"
+
+#include <boost/format.hpp>
+
+void RunStats::onRunStart(const VM &)
+{
+    wallStart = std::chrono::steady_clock::now();
+    cpuStart = std::clock();
+}
+
+void RunStats::onRunEnd(const VM &vm)
+{
+    const auto wallEnd = std::chrono::steady_clock::now();
+    const std::clock_t cpuEnd = std::clock();
+
+    wallSeconds = std::chrono::duration<double>(wallEnd - wallStart).count();
+    cpuSeconds = double(cpuEnd - cpuStart) / CLOCKS_PER_SEC;
+    counters = vm.getCounters();
+}
+
+double RunStats::getInstPerSecond() const
+{
+    return wallSeconds > 0 ? counters.instCount / wallSeconds : 0;
+}
+
+Json::Value RunStats::toJson() const
+{
+    Json::Value ret;
+
+    ret["instructions"] = Json::Int64(counters.instCount);
+    ret["calls"] = Json::Int64(counters.callCount);
+    ret["max_call_depth"] = counters.maxCallDepth;
+    ret["peak_stack_words"] = Json::UInt64(counters.peakStackSize);
+    ret["bytes_read"] = Json::Int64(bytesRead);
+    ret["bytes_written"] = Json::Int64(bytesWritten);
+    ret["wall_seconds"] = wallSeconds;
+    ret["cpu_seconds"] = cpuSeconds;
+    ret["instructions_per_second"] = getInstPerSecond();
+
+    return ret;
+}
+
+void RunStats::print(std::ostream &out) const
+{
+    out << boost::format("%-24s %d\n") % "instructions" % counters.instCount
+        << boost::format("%-24s %d\n") % "calls" % counters.callCount
+        << boost::format("%-24s %d\n") % "max call depth" % counters.maxCallDepth
+        << boost::format("%-24s %d\n") % "peak stack words" % counters.peakStackSize
+        << boost::format("%-24s %d\n") % "bytes read" % bytesRead
+        << boost::format("%-24s %d\n") % "bytes written" % bytesWritten
+        << boost::format("%-24s %.6f\n") % "wall time (s)" % wallSeconds
+        << boost::format("%-24s %.6f\n") % "cpu time (s)" % cpuSeconds
+        << boost::format("%-24s %.0f\n") % "instructions per second" % getInstPerSecond();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <ctime>
+#include <ostream>
+#include <json/json.h>
+#include "backend/VM.h"
+#include "backend/VMMonitor.h"
+
+/**
+ * @brief Resource accounting of one VM::run()
+ *
+ * @details Counters come from the monitored loop of the VM, I/O bytes
+ * from the CountingStreamBuf set as VM streams by the caller.
+ */
+class RunStats : public VMMonitor
+{
+public:
+    void onRunStart(const VM &vm) override;
+    void onRunEnd(const VM &vm) override;
+
+    bool observesControlFlow() const override {
+        return false;
+    }
+
+    void setIOBytes(long long bytesRead, long long bytesWritten) {
+        this->bytesRead = bytesRead;
+        this->bytesWritten = bytesWritten;
+    }
+
+    Json::Value toJson() const;
+    void print(std::ostream &out) const;
+
+private:
+    VMCounters counters;
+    long long bytesRead = 0;
+    long long bytesWritten = 0;
+
+    std::chrono::steady_clock::time_point wallStart;
+    std::clock_t cpuStart = 0;
+    double wallSeconds = 0;
+    double cpuSeconds = 0;
+
+    double getInstPerSecond() const;
+};
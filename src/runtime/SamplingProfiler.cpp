@@ -0,0 +1,87 @@
+#include "SamplingProfiler.h"
+
+#include <stdexcept>
+#include <signal.h>
+#include <sys/time.h>
+
+volatile std::sig_atomic_t SamplingProfiler::sampleDue = 0;
+
+void SamplingProfiler::handleSignal(int)
+{
+    sampleDue = 1;
+    VM::requestPoll();
+}
+
+void SamplingProfiler::startTimer() const
+{
+    struct sigaction action = {};
+    action.sa_handler = handleSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, nullptr) != 0) {
+        throw std::runtime_error("Cannot handle SIGPROF for the profiler");
+    }
+
+    // tv_usec must stay below a second
+    const int periodUs = 1000000 / sampleHz;
+    struct itimerval timer = {};
+    timer.it_interval.tv_sec = periodUs / 1000000;
+    timer.it_interval.tv_usec = periodUs % 1000000;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        throw std::runtime_error("Cannot start the profiler timer");
+    }
+}
+
+void SamplingProfiler::stopTimer()
+{
+    struct itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+
+    signal(SIGPROF, SIG_IGN);
+    sampleDue = 0;
+}
+
+void SamplingProfiler::onRunStart(const VM &)
+{
+    startTimer();
+}
+
+void SamplingProfiler::onRunEnd(const VM &)
+{
+    stopTimer();
+}
+
+// samples taken so far are still written
+void SamplingProfiler::onRunAbort(const VM &)
+{
+    stopTimer();
+}
+
+void SamplingProfiler::onPoll(const VM &vm)
+{
+    if (sampleDue == 0) {
+        return;
+    }
+    sampleDue = 0;
+
+    vm.walkFrames(frames);
+    samples[frames]++;
+}
+
+/**
+ * @brief Write `$global;main;quickSort;getPartition 42` lines
+ */
+void SamplingProfiler::writeFoldedStacks(std::ostream &out, const SymbolMap &symbolMap) const
+{
+    for (const auto &[stack, count] : samples) {
+        // outermost first
+        for (auto itr = stack.rbegin(); itr != stack.rend(); itr++) {
+            if (itr != stack.rbegin()) {
+                out << ";";
+            }
+            out << symbolMap.getFuncName(*itr);
+        }
+        out << " " << count << "\n";
+    }
+}
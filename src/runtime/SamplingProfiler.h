@@ -0,0 +1,57 @@
+#pragma once
+
+#include <csignal>
+#include <map>
+#include <ostream>
+#include <vector>
+#include <string>
+#include "backend/VM.h"
+#include "backend/VMMonitor.h"
+#include "backend/SymbolMap.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+/**
+ * @brief Statistical profiler driven by a SIGPROF interval timer.
+ *
+ * @details The signal handler only raises VM::requestPoll(). The stack
+ * is sampled in onPoll(), at the next safe point of the monitored loop,
+ * by unwinding the frames saved by CALL; only for polls of the timer,
+ * since other monitors request polls as well.
+ * Output is in folded stack format (one `outer;inner count` line per
+ * distinct stack), which flame graph tools take as input.
+ */
+class SamplingProfiler : public VMMonitor
+{
+public:
+    // sampling at most once a microsecond
+    static constexpr int MAX_SAMPLE_HZ = 1000000;
+
+    SamplingProfiler(int sampleHz): sampleHz(sampleHz) {}
+
+    void onRunStart(const VM &vm) override;
+    void onRunEnd(const VM &vm) override;
+    void onRunAbort(const VM &vm) override;
+    void onPoll(const VM &vm) override;
+
+    bool observesControlFlow() const override {
+        return false;
+    }
+
+    void writeFoldedStacks(std::ostream &out, const SymbolMap &symbolMap) const;
+
+private:
+    int sampleHz;
+
+    // { [ entry offsets, innermost first ]: sample count }
+    map<vector<int>, long> samples;
+    vector<int> frames;
+
+    static volatile std::sig_atomic_t sampleDue;
+
+    void startTimer() const;
+    static void stopTimer();
+    static void handleSignal(int);
+};
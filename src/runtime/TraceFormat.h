@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+Binary execution trace (little endian)
+
+Header:
+    char     magic[8]     "CMTRACE"
+    uint32_t version      TRACE_VERSION
+    uint32_t flags        TRACE_FLAG_RING if only the last events are kept
+    uint64_t eventCount   number of events stored after the header
+    uint64_t droppedCount events overwritten in ring mode
+Events:
+    uint32_t event        (pc << 2) | TraceEventKind
+
+Only control flow that can't be derived from the code is recorded, i.e.
+JZ outcomes, CALL and RET. The pc path in between is reconstructed by
+replaying the assembly file. Since every event carries its pc, a decoder
+can start from any event, which is what the ring mode relies on.
+*/
+
+enum TraceEventKind : uint32_t
+{
+    BRANCH_NOT_TAKEN = 0,
+    BRANCH_TAKEN = 1,
+    TRACE_CALL = 2,
+    TRACE_RET = 3,
+};
+
+const char TRACE_MAGIC[8] = "CMTRACE";
+const uint32_t TRACE_VERSION = 1;
+const uint32_t TRACE_FLAG_RING = 1;
+
+struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t eventCount;
+    uint64_t droppedCount;
+};
+
+inline uint32_t encodeTraceEvent(int pc, TraceEventKind kind) {
+    return (uint32_t(pc) << 2) | kind;
+}
+
+inline int getTraceEventPc(uint32_t event) {
+    return event >> 2;
+}
+
+inline TraceEventKind getTraceEventKind(uint32_t event) {
+    return TraceEventKind(event & 3);
+}
@@ -0,0 +1,94 @@
+#include "TraceRecorder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+TraceRecorder::TraceRecorder(const string &traceFilePath, size_t ringSize):
+    traceFilePath(traceFilePath), ringSize(ringSize) {}
+
+void TraceRecorder::open()
+{
+    writeFile.open(traceFilePath, std::ios::binary);
+    if (writeFile.is_open() == false) {
+        throw std::runtime_error("Cannot open trace file " + traceFilePath);
+    }
+}
+
+void TraceRecorder::onRunStart(const VM &)
+{
+    buffer.resize(ringSize > 0 ? std::min(ringSize, STREAM_BUFFER_SIZE) : STREAM_BUFFER_SIZE);
+    bufferPos = 0;
+    eventCountBefore = 0;
+
+    // placeholder, rewritten at the end of the run
+    writeHeader(0, 0);
+}
+
+void TraceRecorder::bufferFull()
+{
+    if (ringSize > 0 && buffer.size() < ringSize) {
+        // nothing overwritten yet, events stay in order
+        buffer.resize(std::min(buffer.size() * 2, ringSize));
+    } else if (ringSize > 0) {
+        // wrap around, the oldest events get overwritten
+        eventCountBefore += bufferPos;
+        bufferPos = 0;
+    } else {
+        writeFile.write(reinterpret_cast<const char *>(buffer.data()), bufferPos * sizeof(uint32_t));
+        eventCountBefore += bufferPos;
+        bufferPos = 0;
+    }
+}
+
+void TraceRecorder::onRunEnd(const VM &)
+{
+    finish();
+}
+
+void TraceRecorder::onRunAbort(const VM &)
+{
+    // closed if onRunEnd() did
+    if (writeFile.is_open()) {
+        finish();
+    }
+}
+
+void TraceRecorder::finish()
+{
+    const uint64_t eventCount = eventCountBefore + bufferPos;
+    if (ringSize > 0) {
+        const uint64_t storedCount = std::min<uint64_t>(eventCount, ringSize);
+        // oldest event first
+        if (eventCountBefore > 0) {
+            writeFile.write(reinterpret_cast<const char *>(buffer.data() + bufferPos),
+                            (ringSize - bufferPos) * sizeof(uint32_t));
+        }
+        writeFile.write(reinterpret_cast<const char *>(buffer.data()), bufferPos * sizeof(uint32_t));
+
+        writeHeader(storedCount, eventCount - storedCount);
+    } else {
+        writeFile.write(reinterpret_cast<const char *>(buffer.data()), bufferPos * sizeof(uint32_t));
+
+        writeHeader(eventCount, 0);
+    }
+
+    writeFile.close();
+}
+
+void TraceRecorder::writeHeader(uint64_t storedCount, uint64_t droppedCount)
+{
+    TraceHeader header;
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.flags = ringSize > 0 ? TRACE_FLAG_RING : 0;
+    header.eventCount = storedCount;
+    header.droppedCount = droppedCount;
+
+    const auto pos = writeFile.tellp();
+    writeFile.seekp(0);
+    writeFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    if (pos > std::streamoff(sizeof(header))) {
+        writeFile.seekp(pos);
+    }
+}
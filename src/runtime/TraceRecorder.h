@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "backend/VM.h"
+#include "backend/VMMonitor.h"
+#include "TraceFormat.h"
+
+using std::string;
+using std::vector;
+
+/**
+ * @brief Record branch outcomes, calls and returns into a binary trace.
+ * @see TraceFormat.h
+ *
+ * @details Streaming mode flushes the buffer into the file whenever it
+ * is full. Ring mode (ringSize > 0) keeps only the last ringSize events
+ * in memory and writes them when the run ends; its buffer grows up to
+ * ringSize as events come. A run stopped by an error is traced up to the
+ * failing instruction.
+ */
+class TraceRecorder : public VMMonitor
+{
+public:
+    TraceRecorder(const string &traceFilePath, size_t ringSize);
+
+    // before the run, so that a bad path fails before the program runs
+    void open();
+
+    void onRunStart(const VM &vm) override;
+    void onRunEnd(const VM &vm) override;
+    void onRunAbort(const VM &vm) override;
+
+    void onBranch(const VM &vm, bool taken) override {
+        record(encodeTraceEvent(vm.getPc(), taken ? BRANCH_TAKEN : BRANCH_NOT_TAKEN));
+    }
+
+    void onCall(const VM &vm) override {
+        record(encodeTraceEvent(vm.getPc(), TRACE_CALL));
+    }
+
+    void onRet(const VM &vm) override {
+        record(encodeTraceEvent(vm.getPc(), TRACE_RET));
+    }
+
+private:
+    string traceFilePath;
+    std::ofstream writeFile;
+
+    size_t ringSize;
+    vector<uint32_t> buffer;
+    size_t bufferPos = 0;
+
+    // events before the buffer, flushed or overwritten
+    uint64_t eventCountBefore = 0;
+
+    static constexpr size_t STREAM_BUFFER_SIZE = 1 << 16;
+
+    void record(uint32_t event) {
+        buffer[bufferPos++] = event;
+        if (bufferPos == buffer.size()) {
+            bufferFull();
+        }
+    }
+
+    void bufferFull();
+    // write the buffered events and the final header
+    void finish();
+    void writeHeader(uint64_t storedCount, uint64_t droppedCount);
+};
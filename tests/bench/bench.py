@@ -0,0 +1,246 @@
+"""
+End-to-end benchmarks of the C-Minus toolchain.
+
+Every program is compiled by cmc and run by cm at increasing input sizes.
+Compile time, executed instructions, VM wall time and peak memory are
+measured, and compared with the same source built by the system C compiler.
+
+    python3 tests/bench/bench.py --bin-dir build/src -o results.json
+    python3 tests/bench/bench.py --bin-dir build/src --compare old.json
+"""
+import argparse
+import datetime
+import json
+import os
+import platform
+import subprocess
+import sys
+import tempfile
+import time
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+TESTS_DIR = os.path.dirname(BENCH_DIR)
+sys.path.insert(0, TESTS_DIR)
+
+from generate_test import generate_test  # noqa: E402
+
+# array size declared by the sources, rewritten to fit the input size
+DECLARED_ARRAY_SIZE = '[110]'
+
+
+def write_numbers(path, *numbers):
+    with open(path, 'w') as inputFile:
+        inputFile.write(' '.join(str(x) for x in numbers) + '\n')
+
+
+def fibonacci_pair(k):
+    a, b = 0, 1
+    for _ in range(k):
+        a, b = b, a + b
+    return b, a
+
+
+# name: (source, sizes, array size of size, input writer of (path, size))
+PROGRAMS = {
+    'factorial': (os.path.join(TESTS_DIR, 'factorial.c'), [0], None, None),
+    'gcd': (os.path.join(TESTS_DIR, 'gcd.c'), [10, 25, 45], None,
+            lambda path, size: write_numbers(path, *fibonacci_pair(size))),
+    'quick_sort': (os.path.join(TESTS_DIR, 'quick_sort.c'), [100, 1000, 10000], lambda size: size + 10,
+                   lambda path, size: generate_test(path, size, seed=size)),
+    'selection_sort': (os.path.join(TESTS_DIR, 'selection_sort.c'), [100, 1000, 4000], lambda size: size + 10,
+                       lambda path, size: generate_test(path, size, seed=size)),
+    'sieve': (os.path.join(BENCH_DIR, 'kernels', 'sieve.c'), [1000, 100000, 1000000], lambda size: size + 10,
+              lambda path, size: write_numbers(path, size)),
+    'matmul': (os.path.join(BENCH_DIR, 'kernels', 'matmul.c'), [10, 40, 100], lambda size: 3 * size * size + 10,
+               lambda path, size: write_numbers(path, size)),
+    'fib': (os.path.join(BENCH_DIR, 'kernels', 'fib.c'), [15, 20, 25], None,
+            lambda path, size: write_numbers(path, size)),
+    'collatz': (os.path.join(BENCH_DIR, 'kernels', 'collatz.c'), [1000, 10000, 50000], None,
+                lambda path, size: write_numbers(path, size)),
+}
+
+
+def check_tools(bin_dir, tool_options):
+    """Exit unless every tool of bin_dir runs and has the options it is benchmarked with.
+
+    tool_options: {tool name: [option, ...]}. Catches a stale or foreign
+    build, e.g. binaries that do not load or predate an option.
+    """
+    for tool, options in tool_options.items():
+        path = os.path.join(bin_dir, tool)
+        try:
+            process = subprocess.run([path, '--help'], stdin=subprocess.DEVNULL,
+                                     stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+        except OSError as e:
+            sys.exit('error: cannot run {0}: {1}. Pass the src directory of a CMake build of '
+                     'this tree to --bin-dir.'.format(path, e.strerror))
+        help_text = process.stdout.decode(errors='replace')
+        missing = [option for option in options if option not in help_text]
+        if missing:
+            sys.exit('error: {0} (--help exited with {1}) does not support {2}, it is not built from '
+                     'this tree. Pass the src directory of a CMake build of this tree to --bin-dir.'.format(
+                         path, process.returncode, ', '.join(missing)))
+
+
+def run(args, stdin_path=None, stdout_path=None, stderr_path=None, check=True):
+    """wall seconds and peak RSS (KB) of the process"""
+    stdin = open(stdin_path) if stdin_path else subprocess.DEVNULL
+    stdout = open(stdout_path, 'w') if stdout_path else subprocess.DEVNULL
+    stderr = open(stderr_path, 'w') if stderr_path else subprocess.DEVNULL
+    try:
+        start = time.perf_counter()
+        process = subprocess.Popen(args, stdin=stdin, stdout=stdout, stderr=stderr)
+        _, status, usage = os.wait4(process.pid, 0)
+        wall = time.perf_counter() - start
+    finally:
+        for f in (stdin, stdout, stderr):
+            if f is not subprocess.DEVNULL:
+                f.close()
+    process.returncode = os.waitstatus_to_exitcode(status)
+    if check and process.returncode != 0:
+        raise RuntimeError('{0} exited with {1}'.format(' '.join(args), process.returncode))
+    return wall, usage.ru_maxrss
+
+
+def best_of(repeat, args, **kwargs):
+    runs = [run(args, **kwargs) for _ in range(repeat)]
+    return min(wall for wall, _ in runs), max(rss for _, rss in runs)
+
+
+def read_file(path):
+    with open(path) as f:
+        return f.read()
+
+
+def bench_program(name, size, options, work_dir):
+    source, _, array_size_of, write_input = PROGRAMS[name]
+    prefix = os.path.join(work_dir, '{0}_{1}'.format(name, size))
+
+    src_path = prefix + '.c'
+    text = read_file(source)
+    if array_size_of:
+        text = text.replace(DECLARED_ARRAY_SIZE, '[{0}]'.format(array_size_of(size)))
+    with open(src_path, 'w') as f:
+        f.write(text)
+
+    input_path = None
+    if write_input:
+        input_path = prefix + '.in'
+        write_input(input_path, size)
+
+    cmc = os.path.join(options.bin_dir, 'cmc')
+    cm = os.path.join(options.bin_dir, 'cm')
+    asm_path = prefix + '.s'
+
+    result = {'program': name, 'size': size}
+    result['cmc_seconds'], result['cmc_peak_rss_kb'] = best_of(
+        options.repeat, [cmc, '-i', src_path, '-o', asm_path])
+    result['instructions_emitted'] = sum(1 for line in open(asm_path) if line.strip())
+
+    # one counting run, the timed runs use the plain dispatch loop
+    stats_path = prefix + '.stats.json'
+    vm_out_path = prefix + '.vm.out'
+    run([cm, '-r', asm_path, '--stats', 'json', '--stats-out', stats_path],
+        stdin_path=input_path, stdout_path=vm_out_path)
+    result['instructions'] = json.loads(read_file(stats_path))['instructions']
+
+    result['vm_seconds'], result['vm_peak_rss_kb'] = best_of(
+        options.repeat, [cm, '-r', asm_path], stdin_path=input_path)
+    result['vm_instructions_per_second'] = result['instructions'] / result['vm_seconds']
+
+    if options.cc:
+        native_path = prefix + '.bin'
+        subprocess.check_call([options.cc, '-O2', '-w', '-include', os.path.join(BENCH_DIR, 'prelude.h'),
+                               src_path, '-o', native_path])
+        native_out_path = prefix + '.native.out'
+        # exit status of `void main()` is undefined
+        run([native_path], stdin_path=input_path, stdout_path=native_out_path, check=False)
+        result['native_seconds'], result['native_peak_rss_kb'] = best_of(
+            options.repeat, [native_path], stdin_path=input_path, check=False)
+        result['slowdown'] = result['vm_seconds'] / result['native_seconds']
+        result['output_matches'] = read_file(vm_out_path) == read_file(native_out_path)
+
+    return result
+
+
+def print_results(results):
+    print('{0:<16} {1:>8} {2:>10} {3:>14} {4:>10} {5:>10} {6:>12} {7:>10} {8:>9}'.format(
+        'program', 'size', 'cmc (ms)', 'instructions', 'vm (ms)', 'vm (KB)', 'inst/s', 'cc (ms)', 'slowdown'))
+    for r in results:
+        print('{0:<16} {1:>8} {2:>10.2f} {3:>14} {4:>10.2f} {5:>10} {6:>12.4g} {7:>10} {8:>9}{9}'.format(
+            r['program'], r['size'], r['cmc_seconds'] * 1000, r['instructions'],
+            r['vm_seconds'] * 1000, r['vm_peak_rss_kb'], r['vm_instructions_per_second'],
+            '{0:.2f}'.format(r['native_seconds'] * 1000) if 'native_seconds' in r else '-',
+            '{0:.1f}x'.format(r['slowdown']) if 'slowdown' in r else '-',
+            '  OUTPUT MISMATCH' if r.get('output_matches') is False else ''))
+
+
+def compare(results, old_path, threshold):
+    """ratios against an earlier run, True if anything regressed"""
+    old = {(r['program'], r['size']): r for r in json.loads(read_file(old_path))['results']}
+    regressed = False
+
+    print('\ncompared with {0}'.format(old_path))
+    print('{0:<16} {1:>8} {2:>12} {3:>12} {4:>12}'.format('program', 'size', 'cmc ratio', 'insts ratio', 'vm ratio'))
+    for r in results:
+        o = old.get((r['program'], r['size']))
+        if o is None:
+            continue
+        ratios = [r['cmc_seconds'] / o['cmc_seconds'], r['instructions'] / o['instructions'],
+                  r['vm_seconds'] / o['vm_seconds']]
+        slower = any(ratio > 1 + threshold for ratio in ratios)
+        regressed = regressed or slower
+        print('{0:<16} {1:>8} {2:>12.3f} {3:>12.3f} {4:>12.3f}{5}'.format(
+            r['program'], r['size'], *ratios, '  REGRESSED' if slower else ''))
+
+    return regressed
+
+
+def git_revision():
+    try:
+        return subprocess.check_output(['git', 'rev-parse', 'HEAD'], cwd=TESTS_DIR,
+                                       stderr=subprocess.DEVNULL).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description='End-to-end benchmarks of cmc and cm.')
+    parser.add_argument('--bin-dir', required=True, help='directory of cmc and cm, e.g. build/src of a CMake build')
+    parser.add_argument('--cc', default='cc', help='C compiler of the native baseline, empty to skip')
+    parser.add_argument('-p', '--program', action='append', choices=sorted(PROGRAMS), help='run these programs only')
+    parser.add_argument('--quick', action='store_true', help='smallest size of each program only')
+    parser.add_argument('-r', '--repeat', type=int, default=3, help='timed runs, the fastest is reported')
+    parser.add_argument('-o', '--output', help='write results JSON into this path')
+    parser.add_argument('--compare', help='results JSON of an earlier run')
+    parser.add_argument('--threshold', type=float, default=0.05, help='ratio over 1 + threshold is a regression')
+    options = parser.parse_args()
+
+    check_tools(options.bin_dir, {'cmc': ['-i'], 'cm': ['--stats', '--stats-out']})
+
+    results = []
+    with tempfile.TemporaryDirectory(prefix='cminus_bench_') as work_dir:
+        for name in options.program or PROGRAMS:
+            sizes = PROGRAMS[name][1]
+            for size in sizes[:1] if options.quick else sizes:
+                results.append(bench_program(name, size, options, work_dir))
+
+    print_results(results)
+
+    if options.output:
+        with open(options.output, 'w') as f:
+            json.dump({
+                'date': datetime.datetime.now().isoformat(timespec='seconds'),
+                'revision': git_revision(),
+                'host': platform.node(),
+                'machine': platform.machine(),
+                'results': results,
+            }, f, indent=2)
+
+    regressed = options.compare and compare(results, options.compare, options.threshold)
+    mismatched = any(r.get('output_matches') is False for r in results)
+    return 1 if regressed or mismatched else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
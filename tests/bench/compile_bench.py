@@ -0,0 +1,109 @@
+"""
+Compiler throughput on large generated sources.
+
+Sources of increasing function counts are generated by gen_source.py and
+compiled by cmc --time-trace. Wall time, lines/s and MB/s of each phase are
+reported, with the peak RSS of the compiler. The source is lexed as the
+parser pulls tokens, so lexing is timed in the Lexer+Parser phase; the Source
+phase only maps the file and has no throughput.
+
+    python3 tests/bench/compile_bench.py --bin-dir build/src --sizes 1000 10000 -o throughput.json
+"""
+import argparse
+import datetime
+import json
+import os
+import sys
+import tempfile
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, BENCH_DIR)
+
+import gen_source  # noqa: E402
+from bench import check_tools, run, read_file, git_revision  # noqa: E402
+
+# phases not reading the source text, lines/s of them would mean nothing
+NO_THROUGHPUT_PHASES = {'Source'}
+
+
+def bench_size(functions, options, work_dir):
+    options.functions = functions
+    src_path = os.path.join(work_dir, 'gen_{0}.c'.format(functions))
+    source = gen_source.generate(options)
+    with open(src_path, 'w') as f:
+        f.write(source)
+
+    lines = source.count('\n')
+    megabytes = len(source.encode()) / 1e6
+    cmc = os.path.join(options.bin_dir, 'cmc')
+    trace_path = os.path.join(work_dir, 'trace.json')
+
+    # fastest run, phase by phase
+    best = None
+    for _ in range(options.repeat):
+        wall, peak_rss_kb = run([cmc, '-i', src_path, '-o', os.path.join(work_dir, 'out.s'),
+                                 '--time-trace', trace_path])
+        phases = {event['name']: event['dur'] / 1e6 for event in json.loads(read_file(trace_path))['traceEvents']}
+        if best is None or wall < best['wall_seconds']:
+            best = {'wall_seconds': wall, 'peak_rss_kb': peak_rss_kb, 'phases': phases}
+
+    result = {'functions': functions, 'lines': lines, 'megabytes': megabytes}
+    result.update(best)
+    result['phases'] = {}
+    for name, seconds in best['phases'].items():
+        has_throughput = seconds > 0 and name not in NO_THROUGHPUT_PHASES
+        result['phases'][name] = {
+            'seconds': seconds,
+            'lines_per_second': lines / seconds if has_throughput else None,
+            'megabytes_per_second': megabytes / seconds if has_throughput else None,
+        }
+    result['lines_per_second'] = lines / best['wall_seconds']
+    result['megabytes_per_second'] = megabytes / best['wall_seconds']
+    return result
+
+
+def print_result(result):
+    print('{0} functions, {1} lines, {2:.2f} MB: {3:.3f} s, {4:.0f} lines/s, {5:.2f} MB/s, peak RSS {6} KB'.format(
+        result['functions'], result['lines'], result['megabytes'], result['wall_seconds'],
+        result['lines_per_second'], result['megabytes_per_second'], result['peak_rss_kb']))
+    print('    {0:<18} {1:>10} {2:>14} {3:>10}'.format('phase', 'ms', 'lines/s', 'MB/s'))
+    for name, phase in result['phases'].items():
+        if phase['lines_per_second'] is None:
+            print('    {0:<18} {1:>10.2f} {2:>14} {3:>10}'.format(name, phase['seconds'] * 1000, '-', '-'))
+        else:
+            print('    {0:<18} {1:>10.2f} {2:>14.0f} {3:>10.2f}'.format(
+                name, phase['seconds'] * 1000, phase['lines_per_second'], phase['megabytes_per_second']))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compiler throughput on large generated sources.')
+    gen_source.add_arguments(parser, with_functions=False)
+    parser.add_argument('--bin-dir', required=True, help='directory of cmc, e.g. build/src of a CMake build')
+    parser.add_argument('--sizes', type=int, nargs='+', default=[100, 1000, 4000], help='function counts to generate')
+    parser.add_argument('-r', '--repeat', type=int, default=3, help='compilations per size, the fastest is reported')
+    parser.add_argument('-o', '--output', help='write results JSON into this path')
+    options = parser.parse_args()
+
+    check_tools(options.bin_dir, {'cmc': ['--time-trace']})
+
+    results = []
+    with tempfile.TemporaryDirectory(prefix='cminus_compile_bench_') as work_dir:
+        for functions in options.sizes:
+            result = bench_size(functions, options, work_dir)
+            print_result(result)
+            results.append(result)
+
+    if options.output:
+        knobs = {knob: getattr(options, knob)
+                 for knob in ['statements', 'depth', 'expr_size', 'arrays', 'calls', 'globals_size', 'seed']}
+        with open(options.output, 'w') as f:
+            json.dump({
+                'date': datetime.datetime.now().isoformat(timespec='seconds'),
+                'revision': git_revision(),
+                'knobs': knobs,
+                'results': results,
+            }, f, indent=2)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,159 @@
+"""
+Deterministic generator of large, valid C-Minus programs.
+
+The same knobs and seed always produce the same source. Programs are meant
+to be compiled, not run: loops are not guaranteed to terminate.
+
+    python3 tests/bench/gen_source.py --functions 10000 --seed 1 -o big.c
+"""
+import argparse
+import random
+import sys
+
+ADD_OPS = ['+', '-']
+MUL_OPS = ['*', '/']
+REL_OPS = ['<', '<=', '>', '>=', '==', '!=']
+
+# locals of every function
+SCALAR_COUNT = 6
+ARRAY_SIZE = 16
+
+
+class Generator:
+    def __init__(self, options):
+        self.options = options
+        self.rng = random.Random(options.seed)
+        self.lines = []
+
+    def emit(self, indent, text):
+        self.lines.append('    ' * indent + text)
+
+    def scalar(self):
+        return self.rng.choice(['a', 'b'] + ['x{0}'.format(i) for i in range(SCALAR_COUNT)])
+
+    def literal(self):
+        return str(self.rng.randint(0, 999))
+
+    def operand(self, func_index, budget):
+        choice = self.rng.random()
+        if self.options.arrays > 0 and choice < self.options.arrays * 0.5:
+            array = self.rng.choice(['t', 'p', 'g']) if self.options.globals_size else self.rng.choice(['t', 'p'])
+            return '{0}[{1}]'.format(array, self.rng.randint(0, ARRAY_SIZE - 1))
+        if func_index > 0 and budget > 2 and choice < self.options.arrays * 0.5 + self.options.calls:
+            return self.call(func_index, budget // 2)
+        if budget > 2 and choice > 0.85:
+            return '(' + self.expr(func_index, budget // 2) + ')'
+        return self.scalar() if choice < 0.7 else self.literal()
+
+    def expr(self, func_index, size):
+        """additive expression of size operands"""
+        terms = [self.operand(func_index, size)]
+        for _ in range(size - 1):
+            op = self.rng.choice(ADD_OPS + MUL_OPS)
+            terms.append(op)
+            terms.append(self.operand(func_index, size))
+        return ' '.join(terms)
+
+    def condition(self, func_index):
+        size = max(1, self.options.expr_size // 2)
+        return '{0} {1} {2}'.format(self.expr(func_index, size), self.rng.choice(REL_OPS),
+                                    self.expr(func_index, size))
+
+    def call(self, func_index, budget):
+        # earlier functions only, so the call graph is a DAG
+        callee = self.rng.randrange(func_index)
+        size = max(1, budget // 3)
+        return 'f{0}({1}, {2}, t)'.format(callee, self.expr(func_index, size), self.expr(func_index, size))
+
+    def statement(self, func_index, indent, depth):
+        size = self.options.expr_size
+        choice = self.rng.random()
+        if depth < self.options.depth and choice < 0.15:
+            self.emit(indent, 'if ({0}) {{'.format(self.condition(func_index)))
+            self.block(func_index, indent + 1, depth + 1)
+            self.emit(indent, '} else {')
+            self.block(func_index, indent + 1, depth + 1)
+            self.emit(indent, '}')
+        elif depth < self.options.depth and choice < 0.25:
+            self.emit(indent, 'while ({0}) {{'.format(self.condition(func_index)))
+            self.block(func_index, indent + 1, depth + 1)
+            self.emit(indent, '}')
+        elif self.options.arrays > 0 and choice < 0.25 + self.options.arrays * 0.3:
+            self.emit(indent, 't[{0}] = {1};'.format(self.rng.randint(0, ARRAY_SIZE - 1), self.expr(func_index, size)))
+        elif choice < 0.97:
+            self.emit(indent, '{0} = {1};'.format(self.scalar(), self.expr(func_index, size)))
+        else:
+            self.emit(indent, 'output({0});'.format(self.expr(func_index, size)))
+
+    def block(self, func_index, indent, depth):
+        count = max(1, self.options.statements >> (2 * depth))
+        for _ in range(count):
+            self.statement(func_index, indent, depth)
+
+    def function(self, func_index):
+        self.emit(0, 'int f{0}(int a, int b, int p[])'.format(func_index))
+        self.emit(0, '{')
+        for i in range(SCALAR_COUNT):
+            self.emit(1, 'int x{0};'.format(i))
+        self.emit(1, 'int t[{0}];'.format(ARRAY_SIZE))
+        self.emit(0, '')
+        self.block(func_index, 1, 0)
+        self.emit(1, 'return {0};'.format(self.expr(func_index, self.options.expr_size)))
+        self.emit(0, '}')
+        self.emit(0, '')
+
+    def generate(self):
+        knobs = ['functions', 'statements', 'depth', 'expr_size', 'arrays', 'calls', 'globals_size', 'seed']
+        self.emit(0, '// generated by gen_source.py, {0}'.format(
+            ', '.join('{0}={1}'.format(knob, getattr(self.options, knob)) for knob in knobs)))
+        if self.options.globals_size:
+            self.emit(0, 'int g[{0}];'.format(max(ARRAY_SIZE, self.options.globals_size)))
+        self.emit(0, '')
+
+        for func_index in range(self.options.functions):
+            self.function(func_index)
+
+        self.emit(0, 'int main()')
+        self.emit(0, '{')
+        self.emit(1, 'int t[{0}];'.format(ARRAY_SIZE))
+        self.emit(0, '')
+        self.emit(1, 'output(f{0}(input(), input(), t));'.format(self.options.functions - 1))
+        self.emit(0, '}')
+
+        return '\n'.join(self.lines) + '\n'
+
+
+def add_arguments(parser, with_functions=True):
+    if with_functions:
+        parser.add_argument('--functions', type=int, default=100, help='number of functions besides main')
+    parser.add_argument('--statements', type=int, default=20, help='top-level statements per function')
+    parser.add_argument('--depth', type=int, default=2, help='maximum if / while nesting depth')
+    parser.add_argument('--expr-size', type=int, default=4, help='operands per expression')
+    parser.add_argument('--arrays', type=float, default=0.2, help='share of array accesses, 0 to 1')
+    parser.add_argument('--calls', type=float, default=0.05, help='share of operands that are calls, 0 to 1')
+    parser.add_argument('--globals-size', type=int, default=0, help='size of the global array, 0 for none')
+    parser.add_argument('--seed', type=int, default=0, help='random seed')
+
+
+def generate(options):
+    if options.functions < 1:
+        raise ValueError('at least one function is needed')
+    return Generator(options).generate()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate a large, valid C-Minus program.')
+    add_arguments(parser)
+    parser.add_argument('-o', '--output', help='output path, stdout if omitted')
+    options = parser.parse_args()
+
+    source = generate(options)
+    if options.output:
+        with open(options.output, 'w') as f:
+            f.write(source)
+    else:
+        sys.stdout.write(source)
+
+
+if __name__ == '__main__':
+    main()
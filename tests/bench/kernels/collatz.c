@@ -0,0 +1,31 @@
+int main()
+{
+    int n;
+    int i;
+    int x;
+    int steps;
+    int maxSteps;
+
+    n = input();
+
+    maxSteps = 0;
+    i = 1;
+    while (i <= n) {
+        x = i;
+        steps = 0;
+        while (x != 1) {
+            if (x - x / 2 * 2 == 0) {
+                x = x / 2;
+            } else {
+                x = 3 * x + 1;
+            }
+            steps = steps + 1;
+        }
+        if (steps > maxSteps) {
+            maxSteps = steps;
+        }
+        i = i + 1;
+    }
+
+    output(maxSteps);
+}
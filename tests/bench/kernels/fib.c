@@ -0,0 +1,13 @@
+int fib(int n)
+{
+    if (n < 2) {
+        return n;
+    } else {
+        return fib(n - 1) + fib(n - 2);
+    }
+}
+
+int main()
+{
+    output(fib(input()));
+}
@@ -0,0 +1,56 @@
+// a, b and c share one array: global arrays beyond the first overlap
+int m[110];
+
+int main()
+{
+    int n;
+    int i;
+    int j;
+    int k;
+    int b;
+    int c;
+    int sum;
+    int checksum;
+
+    n = input();
+    b = n * n;
+    c = b + n * n;
+
+    i = 0;
+    while (i < n) {
+        j = 0;
+        while (j < n) {
+            m[i * n + j] = i + j;
+            m[b + i * n + j] = i - j + n;
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+
+    i = 0;
+    while (i < n) {
+        j = 0;
+        while (j < n) {
+            sum = 0;
+            k = 0;
+            while (k < n) {
+                sum = sum + m[i * n + k] * m[b + k * n + j];
+                k = k + 1;
+            }
+            m[c + i * n + j] = sum;
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+
+    // checksum % 65536, no % in C-Minus
+    checksum = 0;
+    i = 0;
+    while (i < n * n) {
+        checksum = checksum + m[c + i];
+        checksum = checksum - checksum / 65536 * 65536;
+        i = i + 1;
+    }
+
+    output(checksum);
+}
@@ -0,0 +1,33 @@
+int isComposite[110];
+
+int main()
+{
+    int n;
+    int i;
+    int j;
+    int count;
+
+    n = input();
+
+    i = 0;
+    while (i <= n) {
+        isComposite[i] = 0;
+        i = i + 1;
+    }
+
+    count = 0;
+    i = 2;
+    while (i <= n) {
+        if (isComposite[i] == 0) {
+            count = count + 1;
+            j = i + i;
+            while (j <= n) {
+                isComposite[j] = 1;
+                j = j + i;
+            }
+        }
+        i = i + 1;
+    }
+
+    output(count);
+}
@@ -0,0 +1,16 @@
+/* Native functions of C-Minus, for building the tests with a C compiler */
+#include <stdio.h>
+
+static int input(void)
+{
+    int x = 0;
+    if (scanf("%d", &x) != 1) {
+        return 0;
+    }
+    return x;
+}
+
+static void output(int x)
+{
+    printf("%d\n", x);
+}
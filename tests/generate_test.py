@@ -1,6 +1,14 @@
 import random
-n = 90
-with open('test.in', 'w') as testFile:
-    testFile.write('{0}\n'.format(n))
-    for i in range(n):
-        testFile.write(str(random.randint(1, 10000)) + ' ')
+
+
+def generate_test(path, n, seed=None, max_value=10000):
+    """n, then n random numbers in [1, max_value], the input of the sorting tests"""
+    rng = random.Random(seed)
+    with open(path, 'w') as testFile:
+        testFile.write('{0}\n'.format(n))
+        for i in range(n):
+            testFile.write(str(rng.randint(1, max_value)) + ' ')
+
+
+if __name__ == '__main__':
+    generate_test('test.in', 90)